@@ -0,0 +1,330 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <chrono>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "G4RootAnalysisReader.hh"
+#include "G4Version.hh"
+#include "globals.hh"
+
+// Fixed benchmark scenarios (bench/<name>.mac): wall time, event-loop rate,
+// peak RSS and output size of one sim process each, and a chi-square test of
+// the EventEnergy spectrum against bench/reference/<name>.txt, so a speed-up
+// that changes the physics fails. A scenario may be tested against the
+// reference of another one, e.g. the Pb2 fast simulation against full
+// transport.
+//   runBench <sim executable> <bench dir> [-t threads] [--update]
+// --update rewrites the references from this build instead of testing; it
+// is the only mode that writes into <bench dir>. A missing reference, or a
+// spectrum too thin for the test, fails the scenario.
+namespace {
+    struct Scenario {
+        const char* name;
+        const char* reference;
+        const char* option;     // extra sim option, or nullptr
+    };
+    const Scenario kScenarios[] = {
+        {"Th232_Cu1", "Th232_Cu1", nullptr},
+        {"Pb214_Pb1", "Pb214_Pb1", nullptr},
+        {"Pb210_Cu1", "Pb210_Cu1", nullptr},
+        {"gamma609_Pb2", "gamma609_Pb2", nullptr},
+        {"gamma609_Pb2_fast", "gamma609_Pb2", "--fast-pb2"},
+    };
+
+    // adjacent bins are merged until the two spectra hold this many counts
+    const G4double kMinCounts = 20.;
+    // a scenario fails below this p-value
+    const G4double kMinPValue = 1.e-3;
+    // below these the test has no power and the scenario fails instead of
+    // passing vacuously
+    const G4double kMinTotalCounts = 200.;
+    const G4int kMinNdf = 5;
+
+    struct Spectrum {
+        G4int nBins = 0;
+        G4double low = 0., high = 0.;   // keV
+        G4String version;               // Geant4 that recorded a reference
+        std::vector<G4double> value;
+        std::vector<G4double> error;
+
+        G4double Total() const
+        {
+            G4double total = 0.;
+            for (auto v : value) total += v;
+            return total;
+        }
+    };
+
+    struct Result {
+        G4String name;
+        G4bool ok = false;
+        G4double wallSeconds = 0.;
+        G4double events = 0.;
+        G4double loopEventsPerSecond = 0.;
+        G4double peakRSSMB = 0.;
+        std::uintmax_t outputBytes = 0;
+        G4double chi2 = 0.;
+        G4int ndf = 0;
+        G4double pValue = 0.;
+        G4String status;
+    };
+
+    // sim <macro> [-t threads] [option] with its output in <log>; returns the
+    // exit status and the child's peak RSS
+    G4int RunSim(const G4String& sim, const G4String& macro, const G4String& threads, const char* option,
+                 const G4String& log, G4double& peakRSSMB)
+    {
+        std::vector<char*> args{const_cast<char*>(sim.c_str()), const_cast<char*>(macro.c_str())};
+        if (!threads.empty()) {
+            args.push_back(const_cast<char*>("-t"));
+            args.push_back(const_cast<char*>(threads.c_str()));
+        }
+        if (option) args.push_back(const_cast<char*>(option));
+        args.push_back(nullptr);
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            int fd = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd >= 0) {
+                dup2(fd, STDOUT_FILENO);
+                dup2(fd, STDERR_FILENO);
+                close(fd);
+            }
+            execv(sim.c_str(), args.data());
+            _exit(127);
+        }
+        if (pid < 0) return -1;
+
+        int status = 0;
+        struct rusage usage;
+        if (wait4(pid, &status, 0, &usage) < 0) return -1;
+        peakRSSMB = usage.ru_maxrss / 1024.; // kB on Linux
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+
+    // events and event-loop rate from the "[Run]" lines of MyRunAction
+    void ParseLog(const G4String& log, Result& result)
+    {
+        std::ifstream in(log);
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream is(line);
+            std::string tag, word;
+            is >> tag;
+            if (tag != "[Run]") continue;
+            if (line.find("events, ROOT output") != std::string::npos) {
+                is >> result.events;
+            } else if (line.find("Event loop:") != std::string::npos) {
+                G4double seconds;
+                is >> word >> word >> seconds >> word >> result.loopEventsPerSecond;
+            }
+        }
+    }
+
+    G4bool ReadOutput(const G4String& fileName, Spectrum& spectrum)
+    {
+        auto reader = G4RootAnalysisReader::Instance();
+        G4int id = reader->ReadH1("EventEnergy", fileName);
+        if (id < 0) return false;
+        auto h1 = reader->GetH1(id);
+        spectrum.nBins = h1->axis().bins();
+        spectrum.low = h1->axis().lower_edge() * 1000.; // MeV -> keV
+        spectrum.high = h1->axis().upper_edge() * 1000.;
+        spectrum.value.resize(spectrum.nBins);
+        spectrum.error.resize(spectrum.nBins);
+        for (G4int i = 0; i < spectrum.nBins; ++i) {
+            spectrum.value[i] = h1->bin_height(i);
+            spectrum.error[i] = h1->bin_error(i);
+        }
+        return true;
+    }
+
+    // "# EventEnergy <bins> <low keV> <high keV>", "# Geant4 <version>" and
+    // "bin value error" lines for the non-empty bins
+    G4bool ReadReference(const G4String& fileName, Spectrum& spectrum)
+    {
+        std::ifstream in(fileName);
+        std::string hash, name;
+        if (!(in >> hash >> name >> spectrum.nBins >> spectrum.low >> spectrum.high)) return false;
+        spectrum.value.assign(spectrum.nBins, 0.);
+        spectrum.error.assign(spectrum.nBins, 0.);
+        in >> std::ws;
+        if (in.peek() == '#') {
+            std::string line;
+            std::getline(in, line);
+            if (line.rfind("# Geant4 ", 0) == 0) spectrum.version = line.substr(9);
+        }
+        G4int bin;
+        G4double value, error;
+        while (in >> bin >> value >> error) {
+            if (bin < 0 || bin >= spectrum.nBins) return false;
+            spectrum.value[bin] = value;
+            spectrum.error[bin] = error;
+        }
+        return true;
+    }
+
+    void WriteReference(const G4String& fileName, const Spectrum& spectrum)
+    {
+        std::ofstream out(fileName);
+        out << "# EventEnergy " << spectrum.nBins << " " << spectrum.low << " " << spectrum.high << "\n";
+        out << "# Geant4 " << G4Version << "\n";
+        out << std::setprecision(10);
+        for (G4int i = 0; i < spectrum.nBins; ++i) {
+            if (spectrum.value[i] != 0.) out << i << " " << spectrum.value[i] << " " << spectrum.error[i] << "\n";
+        }
+    }
+
+    // two-sample chi-square over merged bins; the p-value uses the
+    // Wilson-Hilferty normal approximation of the chi-square distribution
+    void Compare(const Spectrum& a, const Spectrum& b, Result& result)
+    {
+        G4double sumA = 0., sumB = 0., varA = 0., varB = 0.;
+        result.chi2 = 0.;
+        result.ndf = 0;
+        for (G4int i = 0; i < a.nBins; ++i) {
+            sumA += a.value[i];
+            sumB += b.value[i];
+            varA += a.error[i] * a.error[i];
+            varB += b.error[i] * b.error[i];
+            if (sumA + sumB < kMinCounts && i < a.nBins - 1) continue;
+            if (varA + varB > 0.) {
+                result.chi2 += (sumA - sumB) * (sumA - sumB) / (varA + varB);
+                ++result.ndf;
+            }
+            sumA = sumB = varA = varB = 0.;
+        }
+        if (result.ndf == 0) {
+            result.pValue = 0.;
+            return;
+        }
+        G4double k = result.ndf;
+        G4double z = (std::cbrt(result.chi2 / k) - (1. - 2. / (9. * k))) / std::sqrt(2. / (9. * k));
+        result.pValue = 0.5 * std::erfc(z / std::sqrt(2.));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::cerr << "Usage: runBench <sim executable> <bench dir> [-t threads] [--update]" << std::endl;
+        return 1;
+    }
+    G4String sim = argv[1];
+    G4String benchDir = argv[2];
+    G4String threads;
+    G4bool update = false;
+    for (G4int i = 3; i < argc; ++i) {
+        G4String arg = argv[i];
+        if (arg == "--update") {
+            update = true;
+        } else if (arg == "-t" && i + 1 < argc) {
+            threads = argv[++i];
+        } else {
+            std::cerr << "[bench] Unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    // outputs are relative to the working directory, see the macros
+    std::filesystem::create_directories("bench_out");
+    if (update) std::filesystem::create_directories(benchDir + "/reference");
+
+    std::vector<Result> results;
+    G4bool allOk = true;
+    for (const auto& scenario : kScenarios) {
+        Result result;
+        result.name = scenario.name;
+        G4bool ownReference = result.name == scenario.reference;
+        G4String macro = benchDir + "/" + result.name + ".mac";
+        G4String output = "bench_out/" + result.name + ".root";
+        G4String log = "bench_out/" + result.name + ".log";
+        G4String reference = benchDir + "/reference/" + scenario.reference + ".txt";
+        std::filesystem::remove(output.c_str());
+
+        std::cerr << "[bench] " << result.name << " ..." << std::endl;
+        auto start = std::chrono::steady_clock::now();
+        G4int status = RunSim(sim, macro, threads, scenario.option, log, result.peakRSSMB);
+        result.wallSeconds = std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+        ParseLog(log, result);
+
+        std::error_code ec;
+        result.outputBytes = std::filesystem::file_size(output.c_str(), ec);
+
+        Spectrum spectrum, expected;
+        if (status != 0) {
+            result.status = "sim exited with " + std::to_string(status) + ", see " + log;
+        } else if (ec || !ReadOutput(output, spectrum)) {
+            result.status = "no EventEnergy in " + output;
+        } else if (spectrum.Total() < kMinTotalCounts) {
+            result.status = "only " + std::to_string(static_cast<long long>(spectrum.Total()))
+                + " counts, too few for the test";
+        } else if (update && ownReference) {
+            WriteReference(reference, spectrum);
+            result.ok = true;
+            result.status = "reference written";
+        } else if (!ReadReference(reference, expected)) {
+            result.status = "no " + reference + ", record it with make bench-reference";
+        } else if (expected.nBins != spectrum.nBins) {
+            result.status = "binning differs from the reference";
+        } else if (expected.Total() < kMinTotalCounts) {
+            result.status = "reference has too few counts, record it again";
+        } else {
+            Compare(spectrum, expected, result);
+            if (result.ndf < kMinNdf) {
+                result.status = "only " + std::to_string(result.ndf) + " degrees of freedom, too few for the test";
+            } else {
+                result.ok = result.pValue >= kMinPValue;
+                result.status = result.ok ? "ok" : "spectrum differs from the reference";
+                // a different Geant4 may move the spectra on its own
+                if (expected.version != G4Version) {
+                    result.status += " (reference recorded with "
+                        + (expected.version.empty() ? G4String("an unknown Geant4") : expected.version) + ")";
+                }
+            }
+        }
+        allOk = allOk && result.ok;
+        results.push_back(result);
+    }
+
+    std::cout << std::left << std::setw(18) << "scenario" << std::right << std::setw(10) << "wall s"
+              << std::setw(12) << "events" << std::setw(12) << "events/s" << std::setw(10) << "RSS MB"
+              << std::setw(12) << "bytes" << std::setw(12) << "chi2/ndf" << std::setw(10) << "p"
+              << "  status" << std::endl;
+    for (const auto& r : results) {
+        std::ostringstream chi2;
+        chi2 << std::setprecision(4) << r.chi2 << "/" << r.ndf;
+        std::cout << std::left << std::setw(18) << r.name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << r.wallSeconds << std::setw(12) << std::setprecision(0) << r.events
+                  << std::setw(12) << r.loopEventsPerSecond << std::setw(10) << std::setprecision(1)
+                  << r.peakRSSMB << std::setw(12) << r.outputBytes << std::setw(12) << chi2.str()
+                  << std::setw(10) << std::setprecision(4) << r.pValue << std::defaultfloat
+                  << "  " << r.status << std::endl;
+    }
+
+    // machine-readable copy, to follow the numbers across commits
+    std::ofstream json("bench_out/bench.json");
+    json << "[";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        json << (i ? ",\n" : "\n") << "  {\"scenario\": \"" << r.name << "\", \"ok\": " << (r.ok ? "true" : "false")
+             << ", \"wallSeconds\": " << r.wallSeconds << ", \"events\": " << r.events
+             << ", \"eventsPerSecond\": " << r.loopEventsPerSecond << ", \"peakRSSMB\": " << r.peakRSSMB
+             << ", \"outputBytes\": " << r.outputBytes << ", \"chi2\": " << r.chi2 << ", \"ndf\": " << r.ndf
+             << ", \"pValue\": " << r.pValue << "}";
+    }
+    json << "\n]\n";
+
+    std::cerr << "[bench] " << (allOk ? "all scenarios passed" : "FAILED") << std::endl;
+    return allOk ? 0 : 1;
+}
@@ -3,16 +3,46 @@
 
 #include "G4VUserActionInitialization.hh"
 #include "generator.hh"
+#include "run.hh"
+#include "sourceConfig.hh"
+#include "responseCache.hh"
+#include "decayChain.hh"
+#include "trackCuts.hh"
+#include "convergence.hh"
+#include "phaseSpace.hh"
+#include "stepProfiler.hh"
+#include "fluxTally.hh"
+#include "asyncWriter.hh"
+#include "sourceModel.hh"
+#include "leadTransport.hh"
+#include "nextEvent.hh"
 
 class MyActionInitialization : public G4VUserActionInitialization
 {
 public:
-    MyActionInitialization(detectorShielding* det);
+    MyActionInitialization(detectorShielding* det, SourceConfig* source, ResponseCache* response,
+                           DecayChain* chain, TrackCuts* cuts, ConvergenceMonitor* convergence,
+                           PhaseSpace* phaseSpace, StepProfiler* profiler, FluxTally* flux,
+                           AsyncWriter* writer, SourceModel* model, LeadTransport* transport,
+                           NextEventEstimator* nextEvent);
     virtual ~MyActionInitialization();
 
+    virtual void BuildForMaster() const override;
     virtual void Build() const override;
     
 private:
     detectorShielding* fDet;
+    SourceConfig* fSource;
+    ResponseCache* fResponse;
+    DecayChain* fChain;
+    TrackCuts* fCuts;
+    ConvergenceMonitor* fConvergence;
+    PhaseSpace* fPhaseSpace;
+    StepProfiler* fProfiler;
+    FluxTally* fFlux;
+    AsyncWriter* fWriter;
+    SourceModel* fModel;
+    LeadTransport* fTransport;
+    NextEventEstimator* fNextEvent;
 };
-#endif
\ No newline at end of file
+#endif
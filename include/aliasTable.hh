@@ -0,0 +1,29 @@
+#ifndef ALIASTABLE_HH
+#define ALIASTABLE_HH
+
+#include "globals.hh"
+
+#include <vector>
+
+// Walker alias table: O(1) sampling of an index from a fixed discrete
+// distribution, with one uniform random number per draw.
+class AliasTable
+{
+public:
+    AliasTable();
+    ~AliasTable();
+
+    // weights need not be normalised; returns false if none is positive
+    G4bool Build(const std::vector<G4double>& weights);
+    G4int Sample() const;
+
+    G4int GetSize() const { return static_cast<G4int>(fProbability.size()); }
+    G4double GetTotalWeight() const { return fTotalWeight; }
+
+private:
+    std::vector<G4double> fProbability;
+    std::vector<G4int> fAlias;
+    G4double fTotalWeight;
+};
+
+#endif
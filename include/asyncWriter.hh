@@ -0,0 +1,114 @@
+#ifndef ASYNCWRITER_HH
+#define ASYNCWRITER_HH
+
+#include "G4GenericMessenger.hh"
+#include "G4AutoLock.hh"
+#include "globals.hh"
+
+#include <atomic>
+#include <initializer_list>
+#include <thread>
+#include <vector>
+
+// Rows of the per-event ntuples (Hits, Events, Tracks) go through here. When
+// enabled, every thread that fills rows gets a writer thread: the event loop
+// pushes fixed-size records into a bounded single-producer/single-consumer
+// ring, and the writer thread moves them in batches into a buffer that it
+// hands back. The G4AnalysisManager is thread-local and not thread-safe, so
+// the writer thread never calls it: the owning thread fills and adds the
+// handed-back rows at the end of each event (EndOfEvent) and in Drain. A
+// full ring blocks the event loop (backpressure); the waits are counted and
+// timed. The ring is drained, the thread joined and the last rows added
+// before the output is written and closed. When disabled, rows are filled
+// directly.
+//
+// Shared (master-side) like ConvergenceMonitor.
+class AsyncWriter
+{
+public:
+    enum { kMaxColumns = 10 };
+
+    AsyncWriter();
+    ~AsyncWriter();
+
+    void SetEnabled(G4bool enable) { fEnabled = enable; }
+    void SetQueueDepth(G4int records);
+    void SetBatch(G4int records) { fBatch = records; }
+
+    G4bool IsEnabled() const { return fEnabled; }
+
+    // every thread: one ntuple row, values in column order
+    void AddRow(G4int ntuple, std::initializer_list<G4double> values);
+    // every thread, at the end of each event: fills and adds the rows the
+    // writer thread has handed back
+    void EndOfEvent();
+    // every thread, before the output is written: empties this thread's
+    // ring, joins its writer thread, adds the last rows and adds its
+    // statistics to the run's
+    void Drain();
+
+    // master: before and after the event loop
+    void BeginOfRun();
+    void EndOfRun() const;
+
+private:
+    struct Record {
+        G4int ntuple;
+        G4double value[kMaxColumns];
+    };
+
+    struct Local {
+        std::vector<Record> ring;
+        std::size_t mask = 0;
+        std::size_t batch = 1;
+        std::thread thread;
+        G4bool running = false;
+
+        alignas(64) std::atomic<std::size_t> head{0}; // next slot written by the event loop
+        alignas(64) std::atomic<std::size_t> tail{0}; // next slot read by the writer
+        alignas(64) std::atomic<G4bool> stop{false};
+
+        // rows moved out of the ring by the writer thread, guarded by
+        // handMutex; the owning thread swaps them with the emptied filled
+        // buffer, so neither side allocates once both have grown
+        std::vector<Record> handed;
+        std::vector<Record> filled;
+        G4Mutex handMutex;
+
+        // event loop side
+        G4long records = 0;
+        G4long fullWaits = 0;
+        G4double waitSeconds = 0.;
+        std::size_t maxDepth = 0;
+        // writer side
+        G4long batches = 0;
+    };
+
+    struct Totals {
+        G4int threads = 0;
+        G4long records = 0;
+        G4long fullWaits = 0;
+        G4double waitSeconds = 0.;
+        std::size_t maxDepth = 0;
+        G4long batches = 0;
+    };
+
+    void Start(Local& local);
+    static void Write(Local& local);
+    static void Collect(Local& local);
+    static void Fill(const Record& record);
+
+    G4bool fEnabled;
+    std::size_t fQueueDepth;  // power of two
+    G4int fBatch;
+
+    // statistics of the current run, guarded by fMutex
+    Totals fTotal;
+    G4Mutex fMutex;
+
+    static G4ThreadLocal Local* fLocal;
+
+    G4GenericMessenger* fMessenger;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef CONVERGENCE_HH
+#define CONVERGENCE_HH
+
+#include "G4GenericMessenger.hh"
+#include "G4AutoLock.hh"
+#include "globals.hh"
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+// Stops a run once every EventEnergy region of interest reaches the requested
+// relative uncertainty, or once the wall-clock budget is spent. Workers tally
+// weighted ROI counts per event and merge them into the shared totals every
+// chunk of events; whoever sees the target reached aborts its event loop and
+// the other workers follow at their next event. The beamOn event count stays
+// the upper limit.
+//
+// Shared (master-side) like SourceConfig.
+class ConvergenceMonitor
+{
+public:
+    ConvergenceMonitor();
+    ~ConvergenceMonitor();
+
+    void AddROI(const G4String& input);  // "<lo> <hi> [unit]", default keV
+    void ClearROIs();
+    void SetPrecision(G4double relError) { fTargetPrecision = relError; }
+    void SetTimeBudget(G4double seconds) { fTimeBudget = seconds; }
+    void SetChunk(G4int events) { fChunk = events; }
+
+    // active when ROIs and a precision target or time budget are set
+    G4bool IsActive() const;
+
+    // master: before and after the event loop; EndOfRun fills the
+    // Convergence ntuple before the output file is written
+    void BeginOfRun();
+    void EndOfRun();
+
+    // master: the sub-runs of one autoBeamOn share their tallies and time
+    // budget, so the target applies to the whole decay budget
+    void BeginSeries();
+    void EndSeries();
+    G4bool IsConverged() const { return fConverged; }
+
+    // workers: one call per event with its HPGe energy and weight, or with
+    // its weighted gamma hits under importance biasing (ROIs then count hit
+    // deposits, like HitEnergy), and a final flush of the partial chunk at
+    // the end of the run
+    void AddEvent(G4double energy, G4double weight);
+    void AddHits(const std::vector<G4double>& energies, const std::vector<G4double>& weights);
+    void Flush();
+
+private:
+    struct Tally {
+        std::vector<G4double> sumW;
+        std::vector<G4double> sumW2;
+        G4long events = 0;
+    };
+
+    Tally& GetLocal();
+    void EndOfEvent(Tally& local);
+    G4double GetElapsed() const;
+    G4double GetRelativeError(const Tally& tally, std::size_t roi) const;
+    G4double GetWorstRelativeError() const;
+
+    std::vector<G4double> fROILow;
+    std::vector<G4double> fROIHigh;
+    G4double fTargetPrecision;
+    G4double fTimeBudget; // s, 0: no budget
+    G4int fChunk;
+
+    // shared totals of the current run, guarded by fMutex
+    Tally fTotal;
+    G4Mutex fMutex;
+    std::atomic<G4bool> fConverged;
+    G4bool fSeries;     // between BeginSeries and EndSeries
+    G4bool fStarted;    // totals of the series in use
+    std::chrono::steady_clock::time_point fStart;
+    G4double fLastReport;
+
+    // partial chunk of the calling thread
+    static G4ThreadLocal Tally* fLocal;
+
+    G4GenericMessenger* fMessenger;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef DECAYCHAIN_HH
+#define DECAYCHAIN_HH
+
+#include "G4GenericMessenger.hh"
+#include "globals.hh"
+
+#include "aliasTable.hh"
+
+#include <vector>
+
+// Secular-equilibrium Th232/U238 chains sampled member by member. Instead of
+// shooting the chain head and tracking every daughter through the long-lived
+// gaps, each event decays one member drawn from an alias table weighted by its
+// branching (decays per head decay) and by the relative activity of its
+// sub-chain. Daughters that are themselves members are killed by
+// MyStackingAction, so each event is exactly one decay.
+//
+// Shared (master-side) like SourceConfig; worker generators only read it.
+class DecayChain
+{
+public:
+    struct Member {
+        G4String name;
+        G4int Z;
+        G4int A;
+        G4double excitation; // isomers, e.g. Pa234m
+        G4double branching;  // decays per chain-head decay in equilibrium
+    };
+
+    DecayChain();
+    ~DecayChain();
+
+    void SetChain(const G4String& chain);       // Th232 | U238 | none
+    void SetBreakpoints(const G4String& input); // "Ra226 Pb210"
+    void SetActivity(const G4String& input);    // "<segment head> <relative activity>"
+
+    G4bool IsActive() const { return fTable.GetSize() > 0; }
+    const G4String& GetChainName() const { return fChainName; }
+    const std::vector<Member>& GetMembers() const { return fMembers; }
+    // bumped whenever the table changes, so generators can refresh their ions
+    G4int GetVersion() const { return fVersion; }
+
+    G4int SampleMember() const { return fTable.Sample(); }
+    // member decays per chain-head decay at the configured activities;
+    // spectra per event times this are spectra per chain-head decay
+    G4double GetDecaysPerHead() const { return fTable.GetTotalWeight(); }
+
+    // daughter ions matching a member (ground state or isomer) are not tracked
+    G4bool IsMember(G4int Z, G4int A, G4double excitation) const;
+
+private:
+    void Rebuild();
+    G4int FindMember(const G4String& name) const;
+
+    G4String fChainName;
+    std::vector<Member> fMembers;
+    std::vector<G4int> fSegment;            // segment index of each member
+    std::vector<G4String> fBreakpoints;
+    std::vector<G4double> fSegmentActivity; // relative to equilibrium
+    AliasTable fTable;
+    G4int fVersion;
+
+    G4GenericMessenger* fMessenger;
+};
+
+#endif
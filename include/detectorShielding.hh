@@ -3,10 +3,22 @@
 
 #include "G4VUserDetectorConstruction.hh"
 #include "G4GenericMessenger.hh"
+#include "G4RotationMatrix.hh"
 #include "globals.hh"
 
+#include <chrono>
+#include <vector>
+
 class G4VPhysicalVolume;
 class G4LogicalVolume;
+class G4VisAttributes;
+class G4Material;
+class G4Region;
+class AsyncWriter;
+class SourceModel;
+class ConvergenceMonitor;
+class ResponseCache;
+class LeadTransport;
 
 class detectorShielding : public G4VUserDetectorConstruction
 {
@@ -29,6 +41,22 @@ public:
 
   G4double GetLayerMass(const G4String& layerName);
 
+  // layer index (Cu1=0 ... Pb2=3) or -1, and its inner/outer cubic half-lengths
+  G4int GetLayerIndex(const G4String& layerName) const;
+  void GetLayerBounds(G4int layer, G4double& inner, G4double& outer) const;
+  // material of the built layer, nullptr before the geometry exists
+  G4Material* GetLayerMaterial(G4int layer) const { return fLayerMaterial[layer]; }
+  G4double GetHPGeVolume() const;
+  // HPGe crystal: a cylinder along y, centred in the cavity
+  G4double GetHPGeRadius() const { return fHPGeDiam; }
+  G4double GetHPGeHalfLength() const { return fHPGeHeight; }
+  // specific activity set for a layer (Bq/kg, summed over the set commands)
+  G4double GetLayerActivity(G4int layer) const { return fLayerActivity[layer]; }
+  G4double GetSimulationTime() const { return fSimTime; }
+
+  // geometry parameters as a file-name friendly string, used as a cache key
+  G4String GetGeometryKey() const;
+
   // geometry setters
   void SetInnerCu1Thickness(G4double thickness);
   void SetInnerCu2Thickness(G4double thickness);
@@ -41,11 +69,66 @@ public:
   //G4double GetTotalDecays() const;
   //G4int fTotalDecays;
 
-  G4int GetTotalDecays() const { return fTotalDecays; }
-  void SetTotalDecays(G4int decays);
+  // 64-bit: month-long exposures of the outer lead exceed 2^31 decays
+  G4long GetTotalDecays() const { return fTotalDecays; }
+  void SetTotalDecays(G4double decays); // double so large budgets parse
+  // AutoBeamOn and BeamOn split larger budgets into sub-runs with their own
+  // files and a checkpoint after each
+  void SetMaxEventsPerRun(G4int events);
+  // /Shielding/beamOn: /run/beamOn through the same checkpointed sub-runs
+  void BeamOn(G4double events);
+  // checkpoint intervals below maxEventsPerRun (/Shielding/checkpoint/)
+  void SetCheckpointEvents(G4int events);
+  void SetCheckpointTime(G4double time);
+  // workers, per event: the time interval of the current sub-run is over
+  G4bool SubRunTimeUp() const;
+  // continue the next series from <file>_checkpoint.txt (sim --resume)
+  void SetResumeCheckpoint(const G4String& fileName) { fResumeCheckpoint = fileName; }
+  // the checkpoint key covers the configuration that keys cached responses
+  // (physics, cuts, source) and the job's seed
+  void SetRunConfiguration(const ResponseCache* configuration) { fConfiguration = configuration; }
+  void SetJobKey(const G4String& job) { fJobKey = job; }
+
+  // importance biasing (enabled with sim -b): each layer can be split into
+  // sub-slabs that act as importance cells
+  void SetImportanceBiasing(G4bool enable) { fImportanceBiasing = enable; }
+  G4bool IsImportanceBiasing() const { return fImportanceBiasing; }
+  void SetLayerImportance(const G4String& input);
+  G4VPhysicalVolume* GetWorldVolume() const { return fWorldVolume; }
+
+  // nested boxes instead of boolean shells (/Shielding/geometry/nested)
+  void SetNestedGeometry(G4bool nested);
+  // overlap checks of the placements (/Shielding/checkOverlaps), off by
+  // default as they dominate start-up
+  void SetCheckOverlaps(G4bool check);
+
+  // Hits/Events rows of the HPGe sensitive detector go through the writer
+  void SetAsyncWriter(AsyncWriter* writer) { fWriter = writer; }
+  // autoBeamOn simulates the decays of the model when it has entries
+  void SetSourceModel(SourceModel* model) { fSourceModel = model; }
+  // autoBeamOn sub-runs share the ROI tallies and end once they converged
+  void SetConvergenceMonitor(ConvergenceMonitor* convergence) { fConvergence = convergence; }
+  // photons in Pb2 go to its fast-simulation model when the table is active;
+  // without it (no --fast-pb2) no model is attached
+  void SetLeadTransport(const LeadTransport* transport) { fLeadTransport = transport; }
+
+  // production cuts of the HPGe, copper and lead regions (/Shielding/cuts/)
+  void SetHPGeCut(G4double cut) { SetRegionCut(0, cut); }
+  void SetCopperCut(G4double cut) { SetRegionCut(1, cut); }
+  void SetLeadCut(G4double cut) { SetRegionCut(2, cut); }
 
 private:
   G4VPhysicalVolume* DefineVolumes();
+  void GeometryChanged();
+  void CreateImportanceStore();
+  void SetRegionCut(G4int region, G4double cut);
+  void RunSeries(G4long total);
+  G4long GetSubRunSize() const;
+  G4String GetCheckpointKey() const;
+  void WriteCheckpoint(G4long total, const G4String& base, G4long subRunsDone, G4long eventsDone,
+                       G4bool converged) const;
+  G4bool ReadCheckpoint(const G4String& fileName, G4long total, G4String& base,
+                        G4long& subRunsDone, G4long& remaining) const;
 
   void SetLayerActivityForName(const G4String& name, G4double activityPerKg);
 
@@ -57,13 +140,62 @@ private:
 
   // simulation time storage
   G4double fSimTime = 0;
-  G4int fTotalDecays = 0;
+  G4long fTotalDecays = 0;
+  G4double fLayerActivity[4] = {0., 0., 0., 0.};
+  G4int fMaxEventsPerRun = 10000000;
+  G4int fCheckpointEvents = 0;
+  G4double fCheckpointTime = 0.;
+  // deadline of the current sub-run, set by the master before its BeamOn
+  G4bool fSubRunTimed = false;
+  std::chrono::steady_clock::time_point fSubRunDeadline;
+  G4String fResumeCheckpoint;
+  const ResponseCache* fConfiguration = nullptr;
+  G4String fJobKey;
+  G4GenericMessenger* fCheckpointMessenger;
 
   G4double GetLayerMass(const G4String& name) const;
 
   G4GenericMessenger* fMessenger;
+
+  // importance biasing: per layer, sub-slab importances from the outer face
+  // inwards, and the placed cells of the current geometry
+  struct ImportanceCell {
+    G4VPhysicalVolume* volume;
+    G4int copyNo;
+    G4double importance;
+  };
+  G4bool fImportanceBiasing = false;
+  std::vector<G4double> fLayerImportance[4];
+  std::vector<ImportanceCell> fImportanceCells;
+  G4double fInnerImportance = 1.;   // cavity and HPGe
+  G4double fOuterImportance = 1.;   // world outside Pb2
+  G4GenericMessenger* fBiasingMessenger;
+
+  G4VPhysicalVolume* fWorldVolume = nullptr;
+  G4VPhysicalVolume* fHPGeVolume = nullptr;
+  G4VPhysicalVolume* fCavityVolume = nullptr; // nested geometry or importance biasing
+  G4bool fNestedGeometry = false;
+  G4bool fCheckOverlaps = false;
+  G4GenericMessenger* fGeometryMessenger;
+  G4Material* fLayerMaterial[4] = {nullptr, nullptr, nullptr, nullptr};
+
+  // HPGe, copper, lead; regions outlive geometry rebuilds, their root
+  // volumes are replaced
+  G4Region* fRegions[3] = {nullptr, nullptr, nullptr};
+  // Pb2 alone, with the lead cuts, as the envelope of LeadFastModel
+  G4Region* fPb2Envelope = nullptr;
+  G4double fRegionCut[3];
+  G4GenericMessenger* fCutsMessenger;
+
+  // kept across geometry rebuilds
+  G4RotationMatrix* fHPGeRotation;
+  std::vector<G4VisAttributes*> fVisAttributes;
   std::map<std::string, int> layerMap;
   G4bool fGeometryDirty;
+  AsyncWriter* fWriter = nullptr;
+  SourceModel* fSourceModel = nullptr;
+  ConvergenceMonitor* fConvergence = nullptr;
+  const LeadTransport* fLeadTransport = nullptr;
 };
 
 #endif
@@ -0,0 +1,41 @@
+#ifndef EVENT_HH
+#define EVENT_HH
+
+#include "G4UserEventAction.hh"
+#include "G4Event.hh"
+
+class detectorShielding;
+class ConvergenceMonitor;
+class SensitiveDetector;
+class FluxTally;
+class AsyncWriter;
+class LeadTransport;
+class NextEventEstimator;
+class MyRunAction;
+
+// Hands the HPGe energy of each event to the convergence monitor and the
+// figure of merit of the run action, closes
+// the event of the flux tally, the next-event estimator, the ntuple writer
+// and the Pb2 calibration, and ends a sub-run whose checkpoint time is up.
+class MyEventAction : public G4UserEventAction
+{
+public:
+    MyEventAction(const detectorShielding* det, MyRunAction* run, ConvergenceMonitor* convergence,
+                  FluxTally* flux, AsyncWriter* writer, LeadTransport* transport,
+                  NextEventEstimator* nextEvent);
+    virtual ~MyEventAction();
+
+    virtual void EndOfEventAction(const G4Event*) override;
+
+private:
+    const detectorShielding* fShielding;
+    MyRunAction* fRun;
+    ConvergenceMonitor* fConvergence;
+    FluxTally* fFlux;
+    AsyncWriter* fWriter;
+    LeadTransport* fTransport;
+    NextEventEstimator* fNextEvent;
+    SensitiveDetector* fDetector; // looked up on first use
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef FLUXTALLY_HH
+#define FLUXTALLY_HH
+
+#include "G4GenericMessenger.hh"
+#include "globals.hh"
+
+#include <unordered_map>
+#include <vector>
+
+class detectorShielding;
+class G4Step;
+class G4Track;
+class G4VPhysicalVolume;
+class G4ParticleDefinition;
+class AsyncWriter;
+
+// Track-length flux tally per layer (Cu1, Cu2, Pb1, Pb2, HPGe), binned in
+// the energy at the start of each step. Steps are summed per event on each
+// thread and filled into the Flux_<layer> histograms once per event, so the
+// histogram errors are per-event errors and the worker histograms merge like
+// the spectra. Optionally every tallied track becomes a row of the Tracks
+// ntuple (columnar ROOT output, in place of one text line per track).
+//
+// Shared (master-side) like ConvergenceMonitor.
+class FluxTally
+{
+public:
+    enum { kNLayers = 5 };     // Cu1, Cu2, Pb1, Pb2, HPGe
+    static const G4int kFirstH1 = 2;    // Flux_Cu1 ... Flux_HPGe
+    static const G4int kTracksNtuple = 4;
+
+    FluxTally(const detectorShielding* det);
+    ~FluxTally();
+
+    void SetEnabled(G4bool enable) { fEnabled = enable; }
+    void SetParticle(const G4String& name) { fParticleName = name; }
+    void SetBinning(const G4String& input); // "<bins> <eMax> [unit]"
+    void SetWriteTracks(G4bool write) { fWriteTracks = write; }
+    // Tracks rows go through the writer like the Hits and Events rows
+    void SetAsyncWriter(AsyncWriter* writer) { fWriter = writer; }
+
+    G4bool IsEnabled() const { return fEnabled; }
+    G4bool GetWriteTracks() const { return fWriteTracks; }
+    G4int GetNBins() const { return fNBins; }
+    G4double GetEMax() const { return fEMax; }
+
+    // every thread, before the output file is opened: binning and activation
+    // of the flux histograms and the Tracks ntuple
+    void BeginOfRun();
+    // master: per-layer track length and fluence per event from the merged
+    // histograms
+    void EndOfRun(G4int nEvents) const;
+
+    // workers: from the tracking, stepping and event actions
+    void StartTrack();
+    void AddStep(const G4Step* step);
+    void EndTrack(const G4Track* track);
+    void EndOfEvent();
+
+private:
+    struct Local {
+        const G4ParticleDefinition* particle = nullptr; // nullptr: all particles
+        std::unordered_map<const G4VPhysicalVolume*, G4int> layers;
+        std::vector<G4double> event;   // weighted length per (layer, bin)
+        std::vector<G4int> touched;    // non-zero entries of event
+        G4double track[kNLayers] = {0., 0., 0., 0., 0.};
+        G4bool tallied = false;        // current track has a tallied step
+    };
+
+    G4int GetLayer(Local& local, const G4VPhysicalVolume* volume) const;
+    G4double GetLayerVolume(G4int layer) const;
+
+    const detectorShielding* fDetector;
+
+    G4bool fEnabled;
+    G4String fParticleName;            // "all" for every particle
+    G4int fNBins;
+    G4double fEMax;
+    G4bool fWriteTracks;
+    AsyncWriter* fWriter;
+
+    static G4ThreadLocal Local* fLocal;
+
+    G4GenericMessenger* fMessenger;
+};
+
+#endif
@@ -7,18 +7,67 @@
 #include "G4SystemOfUnits.hh"
 #include "G4ParticleTable.hh"
 
+#include "shellSampler.hh"
+#include "phaseSpace.hh"
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
 class detectorShielding;
+class SourceConfig;
+class DecayChain;
+class PhaseSpace;
+class SourceModel;
+class LeadTransport;
 
 class MyPrimaryGenerator : public G4VUserPrimaryGeneratorAction
 {
 public:
-    MyPrimaryGenerator(const detectorShielding* det);
+    MyPrimaryGenerator(const detectorShielding* det, const SourceConfig* source,
+                       const DecayChain* chain, PhaseSpace* phaseSpace, const SourceModel* model,
+                       LeadTransport* transport);
     virtual ~MyPrimaryGenerator();
     virtual void GeneratePrimaries(G4Event*);
 
+    // vertex generation statistics, collected by MyRunAction
+    G4long GetNVertices() const { return fNVertices; }
+    G4double GetVertexTime() const { return fVertexTime; }
+    void ResetVertexStatistics();
+
+    // process start, for the time to the first generated event of the process
+    static void SetProcessStart(std::chrono::steady_clock::time_point start) { fProcessStart = start; }
+
 private:
+    void UpdateChainIons();
+    void GenerateFromPhaseSpace(G4Event* anEvent);
+    void GenerateFromModel(G4Event* anEvent);
+
     G4GeneralParticleSource* fParticleSource;
     const detectorShielding* fDetector;
+    const SourceConfig* fSource;
+    const DecayChain* fChain;
+    PhaseSpace* fPhaseSpace;
+    const SourceModel* fModel;
+    LeadTransport* fTransport;
+    std::vector<PhaseSpace::Particle> fReplayed;
+
+    // ion of each chain member, built on this thread when the table changes
+    std::vector<G4ParticleDefinition*> fChainIons;
+    G4int fChainVersion;
+
+    ShellSampler fShell;
+
+    // ion of each model entry and a sampler per layer, on this thread
+    std::vector<G4ParticleDefinition*> fModelIons;
+    G4int fModelVersion;
+    ShellSampler fLayerShells[4];
+
+    G4long fNVertices;
+    G4double fVertexTime; // seconds
+
+    static std::chrono::steady_clock::time_point fProcessStart;
+    static std::atomic<G4bool> fFirstEventSeen;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef LEADFASTMODEL_HH
+#define LEADFASTMODEL_HH
+
+#include "G4VFastSimulationModel.hh"
+#include "globals.hh"
+
+#include "leadTransport.hh"
+
+#include <vector>
+
+// Fast-simulation model of the Pb2 envelope region: photons that start in or
+// enter Pb2 are handed to the LeadTransport table instead of being tracked
+// through the lead. One instance per thread, created in ConstructSDandField.
+class LeadFastModel : public G4VFastSimulationModel
+{
+public:
+    LeadFastModel(G4Region* envelope, const LeadTransport* transport);
+    ~LeadFastModel() override = default;
+
+    G4bool IsApplicable(const G4ParticleDefinition& particle) override;
+    G4bool ModelTrigger(const G4FastTrack& fastTrack) override;
+    void DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep) override;
+
+private:
+    const LeadTransport* fTransport;
+    // cell found by ModelTrigger for the DoIt that follows it
+    LeadTransport::Entry fEntry;
+    std::vector<LeadTransport::Emitted> fEmitted;
+};
+
+#endif
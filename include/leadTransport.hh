@@ -0,0 +1,173 @@
+#ifndef LEADTRANSPORT_HH
+#define LEADTRANSPORT_HH
+
+#include "G4GenericMessenger.hh"
+#include "G4AutoLock.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include <cstdint>
+#include <vector>
+
+class detectorShielding;
+class G4Event;
+class G4Step;
+
+// Parameterised photon transport through the outer lead (Pb2). A
+// calibration run (/Shielding/fastPb2/calibrate) shoots photons with full
+// transport from points of known entry energy, depth and angle in the +z
+// slab of Pb2. It records every photon that crosses the inner surface of the
+// layer, with its energy, direction, displacement and delay, and stores the
+// histories on disk per (energy, depth, angle) cell. When enabled,
+// LeadFastModel hands every photon starting or arriving in Pb2 to this
+// table. One history of the photon's cell is drawn; the photon is absorbed
+// unless the history reached the inner surface, and then the history's
+// photons are emitted there.
+//
+// Depth is the distance to the inner cube and the normal points to its
+// nearest point, so the slab tables also serve the edges and corners of the
+// shell. Photons that pass uncollided keep their exact energy and straight
+// path. Scattered primaries are scaled from the grid energy to the entry
+// energy. Secondaries (fluorescence, annihilation) keep their energy.
+//
+// Shared (master-side) like PhaseSpace; worker models and actions only read
+// the table.
+class LeadTransport
+{
+public:
+    // one photon crossing the inner surface in a calibration history, 28 bytes on disk
+    struct Photon {
+        std::int32_t type;    // kUncollided, kScattered, kSecondary
+        float energy;         // secondaries: keV; primaries: fraction of the entry energy
+        float cosine;         // direction . inward normal
+        float phi;            // azimuth relative to the entry direction
+        float along, across;  // mm, displacement in the inner plane
+        float time;           // ns after entry
+    };
+    enum { kUncollided = 0, kScattered = 1, kSecondary = 2 };
+
+    // a photon in Pb2 mapped to its table cell, see FindCell
+    struct Entry {
+        G4int cell;
+        G4double energy;
+        G4ThreeVector position;
+        G4ThreeVector direction;
+        G4double time;
+        G4double depth;       // to the inner cube
+        G4ThreeVector normal; // towards the inner cube
+        G4double cosine;      // direction . normal
+    };
+
+    // a photon emitted at the inner surface
+    struct Emitted {
+        G4double energy;
+        G4ThreeVector position;
+        G4ThreeVector direction;
+        G4double time;
+    };
+
+    LeadTransport(const detectorShielding* det);
+    ~LeadTransport();
+
+    // the model is only attached to Pb2 with sim --fast-pb2
+    void SetModelAttached(G4bool attached) { fModelAttached = attached; }
+    void SetEnabled(G4bool enable);
+    void SetTableFile(const G4String& fileName) { fFileName = fileName; }
+    void SetEnergies(const G4String& input);  // keV, ascending
+    void SetDepthBins(G4int bins);
+    void SetAngleBins(G4int bins);
+    // full-transport calibration run of <histories> per (energy, depth) cell
+    // on the current geometry, written to the table file; an existing file
+    // for the same geometry, physics and grid with as many histories is
+    // loaded instead
+    void Calibrate(G4int histories);
+
+    G4bool IsActive() const { return fEnabled && fLoaded && !fCalibrating; }
+    G4bool IsCalibrating() const { return fCalibrating; }
+
+    // fast model (every thread): false when the table does not cover the photon
+    G4bool FindCell(G4double energy, const G4ThreeVector& position, const G4ThreeVector& direction,
+                    G4double time, Entry& entry) const;
+    // photons leaving the inner surface for one history drawn from the cell
+    // (none when it was absorbed or escaped outwards)
+    void Sample(const Entry& entry, std::vector<Emitted>& emitted) const;
+
+    // calibration (every thread): generator, stepping and event actions
+    void GenerateCalibration(G4Event* event);
+    void AddStep(const G4Step* step);
+    void EndOfEvent();
+
+    // every thread at the end of a run: calibration histories and counters
+    // go to the shared table
+    void Flush();
+    // master: table for the current geometry before the event loop, and the
+    // counters after it
+    void BeginOfRun();
+    void EndOfRun() const;
+
+private:
+    struct Cell {
+        G4long histories = 0;
+        std::vector<std::uint32_t> ends;  // per history reaching the surface: end in photons
+        std::vector<Photon> photons;
+    };
+
+    struct Table {
+        std::vector<G4double> energies;   // keV, ascending
+        G4int depthBins = 0;
+        G4int angleBins = 0;
+        G4double inner = 0.;              // half-length of the inner surface
+        G4double thickness = 0.;
+        G4double density = 0.;            // g/cm3
+        G4long historiesPerCell = 0;
+        std::vector<Cell> cells;          // (energy, depth, angle)
+    };
+
+    struct Local {
+        // calibration history in flight
+        G4bool active = false;
+        G4int cell = 0;
+        G4double energy = 0.;
+        G4double phi = 0.;
+        G4ThreeVector direction;
+        std::vector<Photon> event;
+        std::vector<Cell> cells;
+        // fast model counters
+        G4long photons = 0;
+        G4long emitted = 0;
+    };
+
+    // Pb2 of the current geometry; false before it is built
+    G4bool GetGeometry(Table& table) const;
+    G4bool Read(Table& table) const;
+    void Write() const;
+    void PrintCalibration() const;
+    static Local& GetLocal();
+
+    const detectorShielding* fDetector;
+
+    G4bool fModelAttached;
+    G4bool fEnabled;
+    G4bool fLoaded;
+    G4bool fCalibrating;
+    G4String fFileName;
+
+    // grid of the next calibration
+    std::vector<G4double> fEnergies;  // keV
+    G4int fDepthBins;
+    G4int fAngleBins;
+
+    // table in use, read-only during the event loop
+    Table fTable;
+
+    // counters of the current run, guarded by fMutex
+    G4long fPhotons;
+    G4long fEmitted;
+    G4Mutex fMutex;
+
+    static G4ThreadLocal Local* fLocal;
+
+    G4GenericMessenger* fMessenger;
+};
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef NEXTEVENT_HH
+#define NEXTEVENT_HH
+
+#include "G4GenericMessenger.hh"
+#include "G4AutoLock.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include <chrono>
+#include <utility>
+#include <vector>
+
+class detectorShielding;
+class LeadTransport;
+class G4Step;
+
+// Expected-value scoring of the first photon interactions in the HPGe,
+// alongside the analogue spectra. Each photon flight that starts outside the
+// crystal scores its probability of ending in a first interaction in the
+// crystal; the layers are ray-traced through the known cubic shells with the
+// attenuation lengths of the physics list (G4EmCalculator):
+// - after a Compton scattering (next-event estimator): the scattered photon
+//   is forced towards points drawn uniformly in the crystal, with the
+//   Klein-Nishina probability of that direction and energy, the attenuation
+//   on the way and the interaction probability at the point;
+// - at the start of a photon and after any other scattering: the flight in
+//   the photon's actual direction is traced, and the chance that it reaches
+//   the crystal and interacts in it is scored.
+// The scores fill NEE_Interaction at the energy of arrival, and NEE_Peak
+// weighted by the full-energy-peak fraction at that energy, once per event
+// like the flux tally. The analogue count of the same quantity is kept: a
+// first interaction of a photon track in the HPGe counts when the flight
+// that ends in it starts at a scored site (not in the crystal, and inside the
+// Pb2 model's reach). The end of the run reports both with their errors, how
+// far apart they are and the variance reduction.
+//
+// Shared (master-side) like FluxTally.
+class NextEventEstimator
+{
+public:
+    static const G4int kFirstH1 = 7;    // NEE_Interaction, NEE_Peak
+
+    NextEventEstimator(const detectorShielding* det, const LeadTransport* transport);
+    ~NextEventEstimator();
+
+    void SetEnabled(G4bool enable) { fEnabled = enable; }
+    void SetPoints(G4int points) { fPoints = points; }
+    void AddPeakFraction(const G4String& input); // "<energy keV> <fraction>"
+    void ClearPeakFractions();
+
+    G4bool IsEnabled() const { return fEnabled; }
+
+    // every thread, before the output file is opened: histogram activation
+    // and the attenuation tables of the current geometry
+    void BeginOfRun();
+    // workers: from the stepping and event actions
+    void AddStep(const G4Step* step);
+    void EndOfEvent();
+    // every thread at the end of a run: per-event sums to the shared totals
+    void Flush();
+    // master: analogue and expected-value first interactions with their
+    // errors, and the variance reduction
+    void EndOfRun(G4int nEvents) const;
+
+private:
+    // log-log table of 1/attenuation length, per layer and for the crystal
+    struct Attenuation {
+        std::vector<G4double> mu[5];     // Cu1, Cu2, Pb1, Pb2, HPGe
+        std::vector<G4double> peak;      // photoabsorption share in the crystal
+    };
+
+    struct Local {
+        G4bool active = false;           // enabled and allowed for this run
+        Attenuation table;
+        G4double inner[4] = {0., 0., 0., 0.};
+        G4double outer[4] = {0., 0., 0., 0.};
+        G4double radius = 0.;
+        G4double halfLength = 0.;
+        G4double volume = 0.;
+        G4double cutoff = 0.;            // sites beyond: left to the Pb2 model
+        // current track
+        G4bool interacted = false;       // first interaction in the HPGe done
+        G4bool scoredFlight = false;     // the current flight starts at a scored site
+        // current event
+        std::vector<G4double> interaction, peak; // per energy bin
+        std::vector<G4int> touched;
+        G4double eventScore = 0.;
+        G4double eventAnalog = 0.;
+        // run sums
+        G4double sums[4] = {0., 0., 0., 0.}; // score, score^2, analog, analog^2
+        G4double seconds = 0.;
+    };
+
+    G4double Mu(const Local& local, G4int material, G4double energy) const;
+    G4double PeakFraction(const Local& local, G4double energy) const;
+    // optical depth of the shells between p and q
+    G4double OpticalDepth(const Local& local, const G4ThreeVector& p, const G4ThreeVector& q,
+                          G4double energy) const;
+    G4double ScoreFlight(const Local& local, const G4ThreeVector& p, const G4ThreeVector& direction,
+                         G4double energy) const;
+    void ScoreCompton(Local& local, const G4ThreeVector& p, const G4ThreeVector& direction,
+                      G4double energy, G4double weight) const;
+    void Score(Local& local, G4double energy, G4double score) const;
+
+    const detectorShielding* fDetector;
+    const LeadTransport* fTransport;
+
+    G4bool fEnabled;
+    G4int fPoints;
+    std::vector<std::pair<G4double, G4double>> fPeakFractions; // (energy, fraction), ascending
+
+    // totals of the current run, guarded by fMutex
+    G4double fSums[4];
+    G4double fSeconds;
+    std::chrono::steady_clock::time_point fStart;
+    G4Mutex fMutex;
+
+    static G4ThreadLocal Local* fLocal;
+
+    G4GenericMessenger* fMessenger;
+};
+
+#endif
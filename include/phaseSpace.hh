@@ -0,0 +1,128 @@
+#ifndef PHASESPACE_HH
+#define PHASESPACE_HH
+
+#include "G4GenericMessenger.hh"
+#include "G4AutoLock.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+class detectorShielding;
+class G4Track;
+
+// Two-stage simulation through a phase-space file at the outer surface of
+// one shielding layer (e.g. Cu2: the Pb1 -> Cu2 interface).
+//   record: MySteppingAction stores every particle entering the layer from
+//           outside and kills it, so only the outer shield is transported
+//   replay: MyPrimaryGenerator starts each event from the particles of one
+//           recorded event, optionally recycled and turned by a random
+//           symmetry of the cube, so inner-geometry studies reuse the
+//           outer-shield transport
+// Particles of one source event stay together, so coincidence summing in
+// the HPGe is kept. The file is written in whole events by worker buffers
+// and read under a lock, so it works with any number of threads.
+//
+// Shared (master-side) like SourceConfig.
+class PhaseSpace
+{
+public:
+    enum class Mode { Off, Record, Replay };
+
+    // one particle crossing the boundary, 48 bytes on disk
+    struct Particle {
+        std::int32_t pdg;
+        std::uint32_t flags;          // kFirstInEvent
+        float energy;                 // keV
+        float x, y, z;                // mm
+        float u, v, w;                // direction
+        float weight;
+        double time;                  // ns, global time
+    };
+    static const std::uint32_t kFirstInEvent = 1;
+
+    PhaseSpace(const detectorShielding* det);
+    ~PhaseSpace();
+
+    void SetMode(const G4String& mode);
+    void SetLayer(const G4String& layer);
+    void SetFileName(const G4String& fileName);
+    void SetRecycle(G4int times);
+    void SetSymmetry(G4bool enable) { fSymmetry = enable; }
+
+    G4bool IsRecording() const { return fMode == Mode::Record; }
+    G4bool IsReplaying() const { return fMode == Mode::Replay; }
+    // names of the volumes on either side of the recorded boundary
+    const G4String& GetLayerName() const { return fLayerName; }
+    const G4String& GetOuterName() const { return fOuterName; }
+
+    // stage-1 decays one replayed event stands for (1 when not replaying)
+    G4double GetDecaysPerEvent() const;
+
+    // master: open the file before the event loop, update its header after
+    void BeginOfRun();
+    void EndOfRun(G4int nEvents);
+
+    // workers, record mode: one call per crossing particle, and a final
+    // flush of the buffered events at the end of the run
+    void Record(const G4Track* track, G4int eventID);
+    void Flush();
+
+    // workers, replay mode: the particles of the next event, already turned
+    // by the symmetry drawn for it
+    void NextEvent(std::vector<Particle>& particles);
+
+private:
+    struct Header {
+        char magic[8];
+        std::int32_t version;
+        std::int32_t layer;
+        double boundary;              // mm, cubic half-length
+        std::int64_t sourceEvents;    // stage-1 primaries
+        std::int64_t recordedEvents;  // of which crossed the boundary
+        std::int64_t records;
+    };
+
+    struct Local {
+        std::vector<Particle> records; // record: whole events not yet written
+        G4int lastEventID = -1;
+        std::vector<Particle> event;   // replay: current event and its uses left
+        G4int usesLeft = 0;
+        G4int openCount = 0;           // file the event was read from
+    };
+
+    void Close();
+    void WriteHeader();
+    G4bool ReadRecord(Particle& record);
+    void ReadEvent(std::vector<Particle>& event);
+    static void ApplySymmetry(G4int element, Particle& record);
+
+    const detectorShielding* fDetector;
+
+    Mode fMode;
+    G4int fLayer;
+    G4String fLayerName;
+    G4String fOuterName;
+    G4String fFileName;
+    G4int fRecycle;
+    G4bool fSymmetry;
+
+    // open file and its header, guarded by fMutex
+    std::fstream fFile;
+    G4String fOpenName;
+    Mode fOpenMode;
+    Header fHeader;
+    Particle fPending;                // first record of the next event
+    G4bool fHavePending;
+    G4int fPasses;
+    G4int fOpenCount;                 // files opened so far
+    G4Mutex fMutex;
+
+    static G4ThreadLocal Local* fLocal;
+
+    G4GenericMessenger* fMessenger;
+};
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef PHYSICSLIST_HH
+#define PHYSICSLIST_HH
+
+#include "G4VModularPhysicsList.hh"
+#include "globals.hh"
+
+// Low-energy list for sub-3 MeV gamma spectroscopy: one EM constructor
+// (Livermore or standard option4), decay and radioactive decay, no hadronics.
+class MyPhysicsList : public G4VModularPhysicsList
+{
+public:
+    MyPhysicsList(const G4String& em); // "livermore" | "option4"
+    ~MyPhysicsList() override;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef PHYSICSTABLECACHE_HH
+#define PHYSICSTABLECACHE_HH
+
+#include "G4VStateDependent.hh"
+#include "globals.hh"
+
+class G4VUserPhysicsList;
+
+// Physics tables kept between invocations (sim --fast-start <dir>). Tables
+// built by a process are stored under <dir>/<physics>_<key>/ when it ends,
+// where the key hashes the Geant4 version, the physics list, the production
+// cuts of every region and the material table. The key is taken when the
+// first beamOn enters its initialisation, after the macro's cuts and
+// geometry commands and before the tables are built, so later processes
+// with the same settings retrieve the tables instead of building them.
+// Stored tables are filed under the key of the cuts of the last run that
+// built them.
+class PhysicsTableCache : public G4VStateDependent
+{
+public:
+    PhysicsTableCache(const G4String& directory, const G4String& physicsList);
+    ~PhysicsTableCache() override;
+
+    // master, after runManager->Initialize(): look up stored tables at the
+    // first beamOn
+    void Prepare(G4VUserPhysicsList* physList);
+    // master, before the run manager is deleted: store the tables if this
+    // process built them
+    void Store() const;
+
+    // Idle -> Init before the first run: key and retrieval; -> GeomClosed:
+    // the tables of a run are built
+    G4bool Notify(G4ApplicationState requestedState) override;
+
+    // production cuts of every region that has its own, one line per region
+    static G4String GetCutsText();
+    // FNV-1a hash of a key text as 16 hex digits, stable across processes
+    static G4String HashText(const G4String& text);
+
+private:
+    G4String GetKeyText() const;
+    void SetKey();
+    void Lookup();
+
+    G4String fDirectory;
+    G4String fPhysicsList;
+    G4VUserPhysicsList* fPhysList;
+    G4String fEntry;     // <dir>/<physics>_<hash>
+    G4String fKeyText;
+    G4String fRetrievedEntry;  // empty when the first run built its tables
+    G4bool fBuilt;             // a run has built or retrieved the tables
+};
+
+#endif
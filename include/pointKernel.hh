@@ -0,0 +1,66 @@
+#ifndef POINTKERNEL_HH
+#define POINTKERNEL_HH
+
+#include "G4GenericMessenger.hh"
+#include "globals.hh"
+
+#include <vector>
+
+class detectorShielding;
+
+// Analytic screening estimate of the gamma-line rates in the HPGe for the
+// current /Shielding/ geometry and layer activities, without an event loop.
+// Every layer is integrated as a uniform volume source with Gauss-Legendre
+// quadrature over one octant of its cubic shell (the six face slabs of
+// ShellSampler), the depth coordinate mapped so the nodes follow the
+// attenuation. Each source node is joined by straight rays to quadrature
+// nodes inside the crystal; the rays are attenuated by the path lengths in
+// every layer they cross (NIST mass attenuation coefficients), so the sum is
+// the rate of first interactions of unscattered photons in the crystal.
+// That rate times the peak fraction of the line is the full-energy peak
+// estimate. A second column adds the photons scattered in the shield
+// through point-isotropic build-up factors, a bound for the continuum.
+//
+// Master only, from the UI: /Shielding/pointKernel/run after /run/initialize.
+class PointKernel
+{
+public:
+    PointKernel(const detectorShielding* det);
+    ~PointKernel();
+
+    void AddLine(const G4String& input);     // "<energy keV> <yield> [peak fraction]"
+    void ClearLines();
+    void SetQuadrature(const G4String& input); // "<depth> <lateral>"
+    void SetBuildup(G4bool enable) { fBuildup = enable; }
+
+    void Run();
+
+private:
+    struct Line {
+        G4double energy;
+        G4double yield;         // photons per decay of the layer activity
+        G4double peakFraction;  // full-energy peak / first interactions
+    };
+
+    // quadrature nodes filling the crystal, weights in volume
+    struct Crystal {
+        std::vector<G4double> x, y, z, w;
+    };
+
+    // first-interaction probability in the crystal per photon emitted in
+    // layer, averaged over the layer volume; uncollided and, with build-up,
+    // including shield scatter
+    void Integrate(G4int layer, const Line& line, const Crystal& crystal,
+                   G4double& uncollided, G4double& scattered) const;
+
+    const detectorShielding* fDetector;
+
+    std::vector<Line> fLines;
+    G4int fDepthPoints;
+    G4int fLateralPoints;
+    G4bool fBuildup;
+
+    G4GenericMessenger* fMessenger;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef RESPONSECACHE_HH
+#define RESPONSECACHE_HH
+
+#include "G4GenericMessenger.hh"
+#include "G4AnalysisManager.hh"
+#include "globals.hh"
+
+class detectorShielding;
+class DecayChain;
+class PhaseSpace;
+class SourceConfig;
+class TrackCuts;
+class G4VModularPhysicsList;
+
+// Records the merged EventEnergy spectrum of a run as the response of one
+// (layer, isotope) pair. Entries live under
+// <dir>/<geometry key>_<physics>_<hash>/, where the hash covers the physics
+// constructors, the production cuts of the run, the stacking cuts and the
+// source settings (written out in key.txt), so a cached response is only
+// reused for the same shield, physics and source configuration.
+class ResponseCache
+{
+public:
+    ResponseCache(detectorShielding* det);
+    ~ResponseCache();
+
+    void SetDirectory(const G4String& dir);
+    void Record(const G4String& input); // "<layer> <isotope>"
+
+    static void SetPhysicsListName(const G4String& name) { fPhysicsListName = name; }
+    static const G4String& GetPhysicsListName() { return fPhysicsListName; }
+    // chain-source runs are normalised per chain-head decay
+    void SetDecayChain(const DecayChain* chain) { fChain = chain; }
+    // phase-space replays are normalised per stage-1 decay
+    void SetPhaseSpace(const PhaseSpace* phaseSpace) { fPhaseSpace = phaseSpace; }
+    // the rest of the configuration that enters the entry key
+    void SetPhysicsList(const G4VModularPhysicsList* physList) { fPhysList = physList; }
+    void SetSourceConfig(const SourceConfig* source) { fSource = source; }
+    void SetTrackCuts(const TrackCuts* cuts) { fCuts = cuts; }
+
+    // configuration of the current run, and its entry directory
+    G4String GetKeyText() const;
+    G4String GetEntryDirectory() const;
+
+    // called by the master MyRunAction before the output file is closed
+    void EndOfRun(G4int nEvents);
+
+private:
+    detectorShielding* fDetector;
+    const DecayChain* fChain;
+    const PhaseSpace* fPhaseSpace;
+    const G4VModularPhysicsList* fPhysList;
+    const SourceConfig* fSource;
+    const TrackCuts* fCuts;
+
+    G4String fDirectory;
+    G4String fLayer;
+    G4String fIsotope;
+    G4bool fArmed;
+
+    static G4String fPhysicsListName;
+
+    G4GenericMessenger* fMessenger;
+};
+
+#endif
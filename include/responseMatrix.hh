@@ -0,0 +1,45 @@
+#ifndef RESPONSEMATRIX_HH
+#define RESPONSEMATRIX_HH
+
+#include "globals.hh"
+
+#include <vector>
+
+// On-disk HPGe responses, one file per (layer, isotope) pair. Each file holds
+// the EventEnergy spectrum per simulated decay together with the layer mass,
+// so spectra for any set of Bq/kg activities follow by linear combination.
+namespace ResponseMatrix {
+
+  struct Entry {
+    G4String layer;
+    G4String isotope;
+    G4double massKg = 0.;
+    G4double decays = 0.;
+    G4int nBins = 0;
+    G4double eMinKeV = 0.;
+    G4double eMaxKeV = 0.;
+    std::vector<G4double> value; // counts per decay, per bin
+    std::vector<G4double> sigma; // MC uncertainty of value
+  };
+
+  struct Activity {
+    G4String layer;
+    G4String isotope;
+    G4double bqPerKg = 0.;
+  };
+
+  G4String EntryFileName(const G4String& dir, const G4String& layer, const G4String& isotope);
+
+  G4bool Write(const G4String& fileName, const Entry& entry);
+  G4bool Read(const G4String& fileName, Entry& entry);
+
+  // "layer isotope Bq/kg" lines, '#' starts a comment
+  G4bool ReadActivities(const G4String& fileName, std::vector<Activity>& activities);
+
+  // expected counts (and MC uncertainty) per bin for a live time in seconds
+  G4bool Combine(const G4String& dir, const std::vector<Activity>& activities, G4double liveTime,
+                 Entry& spectrum);
+
+}
+
+#endif
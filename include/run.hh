@@ -0,0 +1,120 @@
+#ifndef RUN_HH
+#define RUN_HH
+
+#include "G4UserRunAction.hh"
+#include "G4Run.hh"
+#include "G4AnalysisManager.hh"
+#include "G4Accumulable.hh"
+#include "G4GenericMessenger.hh"
+#include "G4Timer.hh"
+
+#include <chrono>
+#include <vector>
+
+class MyPrimaryGenerator;
+class MyStackingAction;
+class MyTrackingAction;
+class ConvergenceMonitor;
+class ResponseCache;
+class PhaseSpace;
+class StepProfiler;
+class FluxTally;
+class AsyncWriter;
+class SourceModel;
+class LeadTransport;
+class NextEventEstimator;
+
+// Books the HitEnergy/EventEnergy histograms and the Hits/Events ntuples on
+// every thread. Worker histograms are merged into the master at Write() and
+// ntuple rows are merged into the single master file.
+class MyRunAction : public G4UserRunAction
+{
+public:
+    MyRunAction(MyPrimaryGenerator* generator, MyStackingAction* stacking,
+                MyTrackingAction* tracking, ResponseCache* response,
+                ConvergenceMonitor* convergence, PhaseSpace* phaseSpace,
+                StepProfiler* profiler, FluxTally* flux, AsyncWriter* writer,
+                SourceModel* model, LeadTransport* transport, NextEventEstimator* nextEvent);
+    virtual ~MyRunAction();
+
+    virtual void BeginOfRunAction(const G4Run*) override;
+    virtual void EndOfRunAction(const G4Run*) override;
+
+    // /Shielding/output/ settings, applied to this thread's analysis manager
+    void SetOutputLevel(const G4String& level);
+    void SetCompressionLevel(G4int level);
+    void SetBasketSize(G4int bytes);
+
+    // job i of N (sim --job): the suffix is added to every output file name
+    // and the job is recorded in the RunInfo ntuple
+    static void SetJob(G4int index, G4int nJobs, G4long seed, const G4String& suffix);
+    // <file> with the job suffix, without ".root": the base of every output
+    // of this process, shared with the sub-runs and checkpoints of
+    // detectorShielding::RunSeries
+    static G4String GetJobBaseName(const G4String& fileName);
+    // batch mode, after runManager->Initialize(): the first run reports the
+    // time from here to its first event, i.e. the geometry and physics-table
+    // build of the first beamOn, and the start-up total
+    static void SetStartUp(G4double initialiseSeconds);
+    // sim -b: the figure of merit is taken from HitEnergy, see SensitiveDetector
+    static void SetImportanceBiasing(G4bool enable) { fImportanceBiasing = enable; }
+
+    // workers, at the end of each event: the weighted HitEnergy entries and
+    // the EventEnergy entry of one history, for the figure of merit
+    void AddHistory(const std::vector<G4double>& hitEnergies, const std::vector<G4double>& hitWeights,
+                    G4double eventEnergy, G4bool eventScoring);
+
+private:
+    void PrintFigureOfMerit(G4int nEvents);
+
+    MyPrimaryGenerator* fGenerator; // nullptr on the master
+    MyStackingAction* fStacking;    // nullptr on the master
+    MyTrackingAction* fTracking;    // nullptr on the master
+    ResponseCache* fResponse;
+    ConvergenceMonitor* fConvergence;
+    PhaseSpace* fPhaseSpace;
+    StepProfiler* fProfiler;
+    FluxTally* fFlux;
+    AsyncWriter* fWriter;
+    SourceModel* fModel;
+    LeadTransport* fTransport;
+    NextEventEstimator* fNextEvent;
+
+    // vertex generation cost summed over threads
+    G4Accumulable<G4double> fNVertices = 0.;
+    G4Accumulable<G4double> fVertexTime = 0.;
+
+    // secondaries seen and killed by MyStackingAction, one per KillClass
+    G4Accumulable<G4double> fNTracks = 0.;
+    G4Accumulable<G4double> fNKilled[5] = {0., 0., 0., 0., 0.};
+
+    // navigation cost
+    G4Accumulable<G4double> fNSteps = 0.;
+
+    // per-history score and score^2 of the HitEnergy and EventEnergy
+    // integrals: hits of one event and split copies of one history are
+    // correlated, so the FOM error comes from these, not from the bins
+    G4Accumulable<G4double> fHistoryScore[2] = {0., 0.};
+    G4Accumulable<G4double> fHistoryScore2[2] = {0., 0.};
+    // histogram ranges of this thread, taken at the start of the run
+    G4double fLow[2] = {0., 0.};
+    G4double fHigh[2] = {0., 0.};
+
+    G4String fOutputLevel;
+    // file of the previous run and its name without .root, see BeginOfRunAction
+    G4String fLastFileName;
+    G4String fBaseFileName;
+    G4Timer fTimer;
+    G4GenericMessenger* fMessenger;
+
+    static G4int fJobIndex;
+    static G4int fNJobs;
+    static G4long fSeed;
+    static G4String fJobSuffix;
+    static G4bool fImportanceBiasing;
+    static G4bool fStartUpPending;
+    static G4double fInitialiseSeconds;
+    static std::chrono::steady_clock::time_point fInitialised;
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef RUNOPTIONS_HH
+#define RUNOPTIONS_HH
+
+#include "globals.hh"
+
+// Command line of sim:
+//   sim [macro] [-t nThreads] [-m serial|mt|tasking] [-p physics] [-b]
+//       [--resume checkpoint] [--seed S] [--job i/N] [--output file.root]
+//       [--fast-start dir] [--fast-pb2]
+struct RunOptions
+{
+    G4String macroFile = "";
+    G4String mode = "";
+    G4int nThreads = 0;
+    G4String physics = "ftfp";
+    G4bool biasing = false;
+    G4String resume = "";
+    G4String fastStart = "";  // physics table cache directory
+    G4bool fastPb2 = false;   // Pb2 fast-simulation model (/Shielding/fastPb2/)
+    G4bool help = false;
+
+    // cluster splitting: job i of N gets its own RNG stream and file suffix
+    G4long seed = 0;
+    G4bool seedSet = false;
+    G4int jobIndex = 0;
+    G4int nJobs = 1;
+    G4String output = "";
+};
+
+// false on a malformed command line
+G4bool ParseRunOptions(G4int argc, char** argv, RunOptions& options);
+void PrintUsage();
+
+// Independent, reproducible engine seeds for job i of a split run: the base
+// seed and the job index are mixed with splitmix64, so neighbouring jobs and
+// seeds give unrelated streams. Fills two positive 31-bit seeds and the
+// terminating zero expected by G4Random::setTheSeeds.
+void DeriveJobSeeds(G4long seed, G4int jobIndex, long seeds[3]);
+
+// "_job003" style file suffix, empty for a single job
+G4String JobSuffix(const RunOptions& options);
+
+#endif
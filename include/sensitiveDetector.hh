@@ -5,21 +5,48 @@
 #include "G4Step.hh"
 #include "G4TouchableHistory.hh"
 #include "G4AnalysisManager.hh"
+#include "G4ParticleDefinition.hh"
 
+#include <vector>
+
+class AsyncWriter;
 
 class SensitiveDetector : public G4VSensitiveDetector
 {
 public:
-  SensitiveDetector(const G4String& name);
+  SensitiveDetector(const G4String& name, AsyncWriter* writer);
   ~SensitiveDetector() override;
 
   void Initialize(G4HCofThisEvent*) override;
   G4bool ProcessHits(G4Step* step, G4TouchableHistory*) override;
   void EndOfEvent(G4HCofThisEvent*) override;
 
+  // Under importance biasing the split copies of one history deposit into
+  // the same event with a fraction of its weight each, so their summed
+  // energy is not the energy of any history: EventEnergy and the Events
+  // ntuple are then not filled, and only the per-hit tallies are.
+  void SetEventScoring(G4bool enable) { fEventScoring = enable; }
+  G4bool IsEventScoring() const { return fEventScoring; }
+
+  // last finished event: total energy, and the gamma hits with their weights
+  G4double GetEventEnergy() const { return fTotalEnergyDeposit; }
+  const std::vector<G4double>& GetHitEnergies() const { return fHitEnergy; }
+  const std::vector<G4double>& GetHitWeights() const { return fHitWeight; }
+
 private:
   G4double fTotalEnergyDeposit; 
   G4int fNHits;
+  G4bool fEventScoring;
+
+  const G4ParticleDefinition* fGamma;
+  AsyncWriter* fWriter;  // Hits and Events rows
+
+  // gamma hits of the current event (structure of arrays), written in
+  // EndOfEvent; cleared per event so the capacity is reused
+  std::vector<G4double> fHitEnergy;
+  std::vector<G4int> fHitTrackID;
+  std::vector<G4double> fHitTime;
+  std::vector<G4double> fHitWeight;
   
 };
 
@@ -0,0 +1,34 @@
+#ifndef SHELLSAMPLER_HH
+#define SHELLSAMPLER_HH
+
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+// Uniform, rejection-free sampling inside the cubic shell between the inner
+// and outer half-lengths of one shielding layer. The shell is split into six
+// face slabs (two spanning the full outer face, two the remaining band and two
+// the inner face), one is picked by volume and a point is drawn uniformly in it.
+class ShellSampler
+{
+public:
+    ShellSampler();
+    ~ShellSampler();
+
+    void SetShell(G4double inner, G4double outer);
+    G4ThreeVector Sample() const;
+
+    G4double GetInner() const { return fInner; }
+    G4double GetOuter() const { return fOuter; }
+    G4double GetVolume() const;
+
+private:
+    G4double fInner;
+    G4double fOuter;
+
+    // slab volumes relative to (outer - inner), per pair of opposite faces
+    G4double fWeightOuterFace;
+    G4double fWeightBand;
+    G4double fWeightTotal;
+};
+
+#endif
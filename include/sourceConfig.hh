@@ -0,0 +1,36 @@
+#ifndef SOURCECONFIG_HH
+#define SOURCECONFIG_HH
+
+#include "G4GenericMessenger.hh"
+#include "globals.hh"
+
+class detectorShielding;
+
+// Shared (master-side) choice of how MyPrimaryGenerator places its vertices.
+// Worker generators only read it, so it is configured before beamOn.
+class SourceConfig
+{
+public:
+    enum class Mode { GPS, Shell };
+
+    SourceConfig(const detectorShielding* det);
+    ~SourceConfig();
+
+    void SetMode(const G4String& mode);
+    void SetLayer(const G4String& layer);
+
+    Mode GetMode() const { return fMode; }
+    G4int GetLayer() const { return fLayer; }
+    const G4String& GetLayerName() const { return fLayerName; }
+
+private:
+    const detectorShielding* fDetector;
+
+    Mode fMode;
+    G4int fLayer;
+    G4String fLayerName;
+
+    G4GenericMessenger* fMessenger;
+};
+
+#endif
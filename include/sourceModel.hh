@@ -0,0 +1,90 @@
+#ifndef SOURCEMODEL_HH
+#define SOURCEMODEL_HH
+
+#include "G4GenericMessenger.hh"
+#include "G4VUserEventInformation.hh"
+#include "globals.hh"
+
+#include "aliasTable.hh"
+
+#include <vector>
+
+class detectorShielding;
+
+// Background model of the whole shield in one run: a table of (layer,
+// nuclide, Bq/kg) entries. At the start of each run the entries are weighted
+// by specific activity x layer mass and put into an alias table, so every
+// event decays one nuclide at rest in one layer, drawn in O(1) with the
+// relative normalisation of the model. autoBeamOn then simulates the decays of
+// the whole model over /Shielding/setTime. The sampled (layer, nuclide) is
+// attached to the event as a SourceLabel and written to the Events ntuple.
+// Daughter ions that are themselves entries of the event's layer are killed
+// by MyStackingAction, since they are sampled at their own activity; other
+// daughters decay on within the event.
+//
+// Shared (master-side) like DecayChain; worker generators only read it.
+class SourceModel
+{
+public:
+    struct Entry {
+        G4int layer;         // Cu1=0 ... Pb2=3
+        G4String nuclide;    // e.g. Pb214
+        G4int Z;
+        G4int A;
+        G4double activity;   // Bq/kg
+        G4double decays;     // per second in the whole layer, set by Prepare
+    };
+
+    SourceModel(detectorShielding* det);
+    ~SourceModel();
+
+    void AddEntry(const G4String& input); // "<layer> <nuclide> <Bq/kg>"
+    void Clear();
+    void Print() const;
+
+    G4bool HasEntries() const { return !fEntries.empty(); }
+    G4bool IsActive() const { return fTable.GetSize() > 0; }
+    const std::vector<Entry>& GetEntries() const { return fEntries; }
+    // bumped whenever the table changes, so generators can refresh their ions
+    G4int GetVersion() const { return fVersion; }
+
+    // master, before the event loop: weights the entries with the current
+    // layer masses and builds the table; returns the decays per second of
+    // the whole model (0 when nothing is active). Nothing is recomputed while
+    // the entries and the geometry are unchanged.
+    G4double Prepare();
+
+    G4int SampleEntry() const { return fTable.Sample(); }
+    // ground-state (Z, A) is an entry of the layer
+    G4bool IsEntry(G4int layer, G4int Z, G4int A, G4double excitation) const;
+
+private:
+    detectorShielding* fDetector;
+    std::vector<Entry> fEntries;
+    AliasTable fTable;
+    G4int fVersion;
+    G4bool fPrepared;
+    G4String fPreparedGeometry;  // geometry key of the last Prepare
+
+    G4GenericMessenger* fMessenger;
+};
+
+// (layer, nuclide) an event was generated from, read back by the sensitive
+// detector for the Events ntuple
+class SourceLabel : public G4VUserEventInformation
+{
+public:
+    SourceLabel(G4int layer, G4int pdg) : fLayer(layer), fPDG(pdg) {}
+    virtual ~SourceLabel() {}
+
+    virtual void Print() const override;
+
+    G4int GetLayer() const { return fLayer; }
+    G4int GetPDG() const { return fPDG; } // ion code 100ZZZAAA0
+
+private:
+    G4int fLayer;
+    G4int fPDG;
+};
+
+#endif
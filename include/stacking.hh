@@ -0,0 +1,59 @@
+#ifndef STACKING_HH
+#define STACKING_HH
+
+#include "G4UserStackingAction.hh"
+#include "G4Track.hh"
+
+#include <vector>
+
+class detectorShielding;
+class DecayChain;
+class SourceModel;
+class TrackCuts;
+class G4Material;
+class G4EmCalculator;
+class G4Ions;
+
+// Kills secondaries that cannot contribute to the HPGe signal before they are
+// tracked: neutrinos, tracks created after the time cut, daughter ions of an
+// equilibrium chain (sampled on their own, see DecayChain) or of the source
+// model entries of the event's layer (see SourceModel), and electrons,
+// alphas and stable recoil ions that stop before reaching the cavity (the
+// last three only with /Shielding/stack/rangeCut true).
+class MyStackingAction : public G4UserStackingAction
+{
+public:
+    enum KillClass { kNeutrino, kLate, kChainIon, kElectron, kAlpha, kNKillClasses };
+
+    MyStackingAction(const detectorShielding* det, const DecayChain* chain, const SourceModel* model,
+                     const TrackCuts* cuts);
+    virtual ~MyStackingAction();
+
+    virtual G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track* track) override;
+    virtual void PrepareNewEvent() override;
+
+    // per-thread statistics, collected by MyRunAction
+    G4long GetNTracks() const { return fNTracks; }
+    G4long GetNKilled(G4int killClass) const { return fNKilled[killClass]; }
+    void ResetCounters();
+
+private:
+    G4bool StopsBeforeCavity(const G4Track* track) const;
+    G4bool IsStableIon(const G4Ions* ion) const;
+
+    const detectorShielding* fDetector;
+    const DecayChain* fChain;
+    const SourceModel* fModel;
+    const TrackCuts* fCuts;
+
+    G4EmCalculator* fCalculator;
+    // refreshed per event, the geometry may change between runs
+    std::vector<const G4Material*> fShellMaterials;
+    G4double fCavityHalf;
+    G4int fModelLayer;  // layer of a source model event, -1 otherwise
+
+    G4long fNTracks;
+    G4long fNKilled[kNKillClasses];
+};
+
+#endif
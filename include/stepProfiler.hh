@@ -0,0 +1,78 @@
+#ifndef STEPPROFILER_HH
+#define STEPPROFILER_HH
+
+#include "G4GenericMessenger.hh"
+#include "G4AutoLock.hh"
+#include "globals.hh"
+
+#include <chrono>
+#include <map>
+#include <tuple>
+
+class G4Step;
+class G4VPhysicalVolume;
+class G4ParticleDefinition;
+class G4VProcess;
+
+// Optional profile of where the event loop spends its time: steps and wall
+// time per (volume, particle, process), with the volume taken at the start of
+// the step and the process that limited it. The time of a step is the wall
+// time since the previous step (or the start) of the same track, so it
+// includes the user actions of that step. Workers tally per thread with
+// pointer keys and merge into named totals at the end of the run, where the
+// master prints the table and writes it as JSON.
+//
+// Shared (master-side) like ConvergenceMonitor. When disabled, the stepping
+// and tracking actions only test IsEnabled().
+class StepProfiler
+{
+public:
+    StepProfiler();
+    ~StepProfiler();
+
+    void SetEnabled(G4bool enable) { fEnabled = enable; }
+    void SetOutput(const G4String& fileName) { fOutput = fileName; }
+    void SetRows(G4int rows) { fRows = rows; }
+
+    G4bool IsEnabled() const { return fEnabled; }
+
+    // master: before and after the event loop
+    void BeginOfRun();
+    void EndOfRun(G4int nEvents);
+
+    // workers: from the tracking and stepping actions, and a final flush of
+    // this thread's tally at the end of the run
+    void StartTrack();
+    void AddStep(const G4Step* step);
+    void Flush();
+
+private:
+    struct Entry {
+        G4long steps = 0;
+        G4double seconds = 0.;
+    };
+    using LocalKey = std::tuple<const G4VPhysicalVolume*, const G4ParticleDefinition*, const G4VProcess*>;
+    using Key = std::tuple<G4String, G4String, G4String>; // volume, particle, process
+
+    struct Local {
+        std::map<LocalKey, Entry> entries;
+        std::chrono::steady_clock::time_point last;
+    };
+
+    void WriteJson(G4int nEvents, G4double seconds, G4long steps) const;
+
+    G4bool fEnabled;
+    G4String fOutput;
+    G4int fRows;
+
+    // totals of the current run, guarded by fMutex
+    std::map<Key, Entry> fTotal;
+    G4Mutex fMutex;
+    std::chrono::steady_clock::time_point fStart;
+
+    static G4ThreadLocal Local* fLocal;
+
+    G4GenericMessenger* fMessenger;
+};
+
+#endif
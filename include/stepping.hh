@@ -0,0 +1,36 @@
+#ifndef STEPPING_HH
+#define STEPPING_HH
+
+#include "G4UserSteppingAction.hh"
+#include "G4Step.hh"
+
+class PhaseSpace;
+class StepProfiler;
+class FluxTally;
+class LeadTransport;
+class NextEventEstimator;
+
+// Feeds the step profiler (/Shielding/profile/enable), the flux tally
+// (/Shielding/flux/enable), the next-event estimator
+// (/Shielding/nextEvent/enable) and the Pb2 calibration
+// (/Shielding/fastPb2/calibrate), and records and kills particles entering
+// the phase-space boundary layer from outside (/Shielding/phaseSpace/mode
+// record).
+class MySteppingAction : public G4UserSteppingAction
+{
+public:
+    MySteppingAction(PhaseSpace* phaseSpace, StepProfiler* profiler, FluxTally* flux,
+                     LeadTransport* transport, NextEventEstimator* nextEvent);
+    virtual ~MySteppingAction();
+
+    virtual void UserSteppingAction(const G4Step* step) override;
+
+private:
+    PhaseSpace* fPhaseSpace;
+    StepProfiler* fProfiler;
+    FluxTally* fFlux;
+    LeadTransport* fTransport;
+    NextEventEstimator* fNextEvent;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef SWEEP_HH
+#define SWEEP_HH
+
+#include "G4GenericMessenger.hh"
+#include "globals.hh"
+
+#include <vector>
+
+class detectorShielding;
+
+// Runs one beamOn per point of a grid of shield thicknesses and cavity
+// half-lengths inside a single process. Only the geometry is rebuilt between
+// points (materials are cached, physics tables are kept) and each point
+// writes its own output file <base>_<point>.root, indexed in <base>_points.txt.
+class ShieldingSweep
+{
+public:
+    ShieldingSweep(detectorShielding* det);
+    ~ShieldingSweep();
+
+    void AddParameter(const G4String& input); // "<parameter> <values in mm...>"
+    void Clear();
+    void SetEvents(G4int events) { fEvents = events; }
+    void SetOutput(const G4String& base) { fOutput = base; }
+    void Run();
+
+private:
+    using Setter = void (detectorShielding::*)(G4double);
+
+    struct Axis {
+        G4String name;
+        Setter setter;
+        std::vector<G4double> values;
+    };
+
+    detectorShielding* fDetector;
+    std::vector<Axis> fAxes;
+    G4int fEvents;
+    G4String fOutput;
+
+    G4GenericMessenger* fMessenger;
+};
+
+#endif
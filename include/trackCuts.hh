@@ -0,0 +1,34 @@
+#ifndef TRACKCUTS_HH
+#define TRACKCUTS_HH
+
+#include "G4GenericMessenger.hh"
+#include "globals.hh"
+
+// Shared (master-side) settings of the MyStackingAction cuts, so the
+// /Shielding/stack/ commands exist on the master as well as on workers.
+class TrackCuts
+{
+public:
+    TrackCuts();
+    ~TrackCuts();
+
+    void SetKillNeutrinos(G4bool kill);
+    void SetRangeCut(G4bool enable);
+    void SetElectronMaxEnergy(G4double energy);
+    void SetTimeCut(G4double time);
+
+    G4bool GetKillNeutrinos() const { return fKillNeutrinos; }
+    G4bool GetRangeCut() const { return fRangeCut; }
+    G4double GetElectronMaxEnergy() const { return fElectronMaxEnergy; }
+    G4double GetTimeCut() const { return fTimeCut; } // 0: no cut
+
+private:
+    G4bool fKillNeutrinos;
+    G4bool fRangeCut;
+    G4double fElectronMaxEnergy;
+    G4double fTimeCut;
+
+    G4GenericMessenger* fMessenger;
+};
+
+#endif
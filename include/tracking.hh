@@ -0,0 +1,32 @@
+#ifndef TRACKING_HH
+#define TRACKING_HH
+
+#include "G4UserTrackingAction.hh"
+#include "G4Track.hh"
+
+class StepProfiler;
+class FluxTally;
+
+// Counts tracks and steps for the navigation cost report (steps/s) printed by
+// MyRunAction, starts the step clock of the profiler and brackets the tracks
+// of the flux tally.
+class MyTrackingAction : public G4UserTrackingAction
+{
+public:
+    MyTrackingAction(StepProfiler* profiler, FluxTally* flux);
+    virtual ~MyTrackingAction();
+
+    virtual void PreUserTrackingAction(const G4Track* track) override;
+    virtual void PostUserTrackingAction(const G4Track* track) override;
+
+    // per-thread statistics, collected by MyRunAction
+    G4long GetNSteps() const { return fNSteps; }
+    void ResetCounters() { fNSteps = 0; }
+
+private:
+    StepProfiler* fProfiler;
+    FluxTally* fFlux;
+    G4long fNSteps;
+};
+
+#endif
@@ -0,0 +1,311 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "G4AnalysisManager.hh"
+#include "G4RootAnalysisReader.hh"
+#include "globals.hh"
+
+// Merges the ROOT files of split jobs (sim --job i/N) into one file.
+//   merge <output.root> <job files...>
+// Histograms are summed. Hits/Events/Tracks/Convergence/RunInfo rows are
+// streamed file by file, with EventIDs shifted by the events of the
+// preceding files (RunInfo NEvents), so merged EventIDs stay unique; they
+// are written as doubles, exact beyond 2^31 merged events. The Flux_<layer>
+// (/Shielding/flux/) and NEE_ (/Shielding/nextEvent/) histograms are summed
+// when the first accepted file has them. Every object of a file is checked
+// before anything of it is added, so a file is either merged whole or
+// skipped. The reader is closed and reset after each file, so only one input
+// is held in memory next to the output.
+namespace {
+    // histograms that are only written when their tally is enabled
+    struct Optional { const char* name; const char* title; };
+    const Optional kOptional[] = {
+        {"Flux_Cu1", "Track length per event in Cu1 (mm)"},
+        {"Flux_Cu2", "Track length per event in Cu2 (mm)"},
+        {"Flux_Pb1", "Track length per event in Pb1 (mm)"},
+        {"Flux_Pb2", "Track length per event in Pb2 (mm)"},
+        {"Flux_HPGe", "Track length per event in HPGe (mm)"},
+        {"NEE_Interaction", "Expected first interactions in HPGe per event"},
+        {"NEE_Peak", "Estimated full-energy peak counts per event"},
+    };
+    const G4int kNOptional = sizeof(kOptional) / sizeof(kOptional[0]);
+
+    const char* kLengthColumns[5] = {"Length_Cu1_mm", "Length_Cu2_mm", "Length_Pb1_mm",
+                                     "Length_Pb2_mm", "Length_HPGe_mm"};
+    const char* kConvergenceColumns[7] = {"LowKeV", "HighKeV", "Counts", "RelError", "Target",
+                                          "Events", "Seconds"};
+
+    struct HitRow { G4int eventID, trackID, pdg; G4float energy, weight; G4double time; };
+    struct EventRow { G4int eventID, nHits, sourceLayer, sourcePDG; G4float energy, weight; };
+    struct TrackRow { G4int eventID, trackID, pdg, finalVolume; G4float energy, length[5]; };
+    struct RunRow { G4double nEvents, seed; G4int jobIndex, nJobs; };
+
+    G4bool SameBinning(const tools::histo::h1d* a, const tools::histo::h1d* b)
+    {
+        return a->axis().bins() == b->axis().bins() && a->axis().lower_edge() == b->axis().lower_edge()
+            && a->axis().upper_edge() == b->axis().upper_edge();
+    }
+
+    void BookOutput(G4AnalysisManager* out, tools::histo::h1d* hitEnergy, tools::histo::h1d* eventEnergy)
+    {
+        // same layout as MyRunAction, so the merged file reads like a sim
+        // file, except for the EventID columns
+        out->CreateH1("HitEnergy", "Energy per Hit in HPGe", hitEnergy->axis().bins(),
+                      hitEnergy->axis().lower_edge(), hitEnergy->axis().upper_edge());
+        out->CreateH1("EventEnergy", "Total Energy per Event in HPGe", eventEnergy->axis().bins(),
+                      eventEnergy->axis().lower_edge(), eventEnergy->axis().upper_edge());
+
+        out->CreateNtuple("Hits", "Individual Hit Data");
+        out->CreateNtupleDColumn("EventID");
+        out->CreateNtupleFColumn("Energy_keV");
+        out->CreateNtupleIColumn("TrackID");
+        out->CreateNtupleIColumn("PDG");
+        out->CreateNtupleDColumn("Time_ns");
+        out->CreateNtupleFColumn("Weight");
+        out->FinishNtuple();
+
+        out->CreateNtuple("Events", "Event Summary");
+        out->CreateNtupleDColumn("EventID");
+        out->CreateNtupleFColumn("TotalEnergy_keV");
+        out->CreateNtupleIColumn("NHits");
+        out->CreateNtupleFColumn("Weight");
+        out->CreateNtupleIColumn("SourceLayer");
+        out->CreateNtupleIColumn("SourcePDG");
+        out->FinishNtuple();
+
+        out->CreateNtuple("Convergence", "ROI precision of the run");
+        for (auto column : kConvergenceColumns) out->CreateNtupleDColumn(column);
+        out->FinishNtuple();
+
+        out->CreateNtuple("RunInfo", "Run and job summary");
+        out->CreateNtupleDColumn("NEvents");
+        out->CreateNtupleIColumn("JobIndex");
+        out->CreateNtupleIColumn("NJobs");
+        out->CreateNtupleDColumn("Seed");
+        out->FinishNtuple();
+
+        out->CreateNtuple("Tracks", "Track length per layer");
+        out->CreateNtupleDColumn("EventID");
+        out->CreateNtupleIColumn("TrackID");
+        out->CreateNtupleIColumn("PDG");
+        out->CreateNtupleFColumn("Energy_keV");
+        for (auto column : kLengthColumns) out->CreateNtupleFColumn(column);
+        out->CreateNtupleIColumn("FinalVolume");
+        out->FinishNtuple();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::cerr << "Usage: merge <output.root> <job files...>" << std::endl;
+        return 1;
+    }
+
+    auto reader = G4RootAnalysisReader::Instance();
+    reader->SetVerboseLevel(0);
+    auto out = G4AnalysisManager::Instance();
+    out->SetDefaultFileType("root");
+    out->SetVerboseLevel(0);
+
+    G4bool booked = false;
+    std::vector<G4int> optionalIds(kNOptional, -1);
+    G4double eventOffset = 0.;
+    G4double totalEvents = 0.;
+    G4int merged = 0;
+
+    for (G4int f = 2; f < argc; ++f) {
+        G4String fileName = argv[f];
+
+        // --- read and check everything of this file
+        G4int hitId = reader->ReadH1("HitEnergy", fileName);
+        G4int eventId = reader->ReadH1("EventEnergy", fileName);
+        if (hitId < 0 || eventId < 0) {
+            std::cerr << "[merge] " << fileName << ": no HitEnergy/EventEnergy histograms, skipped" << std::endl;
+            reader->CloseFiles();
+            continue;
+        }
+        std::vector<G4int> fileOptional(kNOptional, -1);
+        for (G4int i = 0; i < kNOptional; ++i) {
+            fileOptional[i] = reader->ReadH1(kOptional[i].name, fileName);
+        }
+
+        // binnings are checked against the output once it is booked
+        G4String problem;
+        if (booked && (!SameBinning(out->GetH1(0), reader->GetH1(hitId)) ||
+                       !SameBinning(out->GetH1(1), reader->GetH1(eventId)))) {
+            problem = "HitEnergy/EventEnergy binning differs";
+        }
+        for (G4int i = 0; i < kNOptional && problem.empty() && booked; ++i) {
+            if (optionalIds[i] < 0) continue;
+            if (fileOptional[i] < 0 || !SameBinning(out->GetH1(optionalIds[i]), reader->GetH1(fileOptional[i]))) {
+                problem = G4String(kOptional[i].name) + " missing or binned differently";
+            }
+        }
+
+        // ntuples are optional (output level, tallies), but a present one
+        // must have every column
+        RunRow run{0., 0., 0, 1};
+        HitRow hit{0, 0, 0, 0.f, 1.f, 0.};
+        EventRow event{0, 0, -1, 0, 0.f, 1.f};
+        TrackRow track{0, 0, 0, -1, 0.f, {0.f, 0.f, 0.f, 0.f, 0.f}};
+        std::vector<G4double> convergenceValues(7, 0.);
+
+        G4int runInfo = reader->GetNtuple("RunInfo", fileName);
+        if (runInfo >= 0 && problem.empty()) {
+            G4bool bound = reader->SetNtupleDColumn(runInfo, "NEvents", run.nEvents)
+                && reader->SetNtupleIColumn(runInfo, "JobIndex", run.jobIndex)
+                && reader->SetNtupleIColumn(runInfo, "NJobs", run.nJobs)
+                && reader->SetNtupleDColumn(runInfo, "Seed", run.seed);
+            if (!bound) problem = "RunInfo columns differ";
+        }
+        G4int hits = reader->GetNtuple("Hits", fileName);
+        if (hits >= 0 && problem.empty()) {
+            G4bool bound = reader->SetNtupleIColumn(hits, "EventID", hit.eventID)
+                && reader->SetNtupleFColumn(hits, "Energy_keV", hit.energy)
+                && reader->SetNtupleIColumn(hits, "TrackID", hit.trackID)
+                && reader->SetNtupleIColumn(hits, "PDG", hit.pdg)
+                && reader->SetNtupleDColumn(hits, "Time_ns", hit.time)
+                && reader->SetNtupleFColumn(hits, "Weight", hit.weight);
+            if (!bound) problem = "Hits columns differ";
+        }
+        G4int events = reader->GetNtuple("Events", fileName);
+        if (events >= 0 && problem.empty()) {
+            G4bool bound = reader->SetNtupleIColumn(events, "EventID", event.eventID)
+                && reader->SetNtupleFColumn(events, "TotalEnergy_keV", event.energy)
+                && reader->SetNtupleIColumn(events, "NHits", event.nHits)
+                && reader->SetNtupleFColumn(events, "Weight", event.weight)
+                && reader->SetNtupleIColumn(events, "SourceLayer", event.sourceLayer)
+                && reader->SetNtupleIColumn(events, "SourcePDG", event.sourcePDG);
+            if (!bound) problem = "Events columns differ";
+        }
+        G4int tracks = reader->GetNtuple("Tracks", fileName);
+        if (tracks >= 0 && problem.empty()) {
+            G4bool bound = reader->SetNtupleIColumn(tracks, "EventID", track.eventID)
+                && reader->SetNtupleIColumn(tracks, "TrackID", track.trackID)
+                && reader->SetNtupleIColumn(tracks, "PDG", track.pdg)
+                && reader->SetNtupleFColumn(tracks, "Energy_keV", track.energy)
+                && reader->SetNtupleIColumn(tracks, "FinalVolume", track.finalVolume);
+            for (G4int c = 0; c < 5; ++c) {
+                bound = bound && reader->SetNtupleFColumn(tracks, kLengthColumns[c], track.length[c]);
+            }
+            if (!bound) problem = "Tracks columns differ";
+        }
+        G4int convergence = reader->GetNtuple("Convergence", fileName);
+        if (convergence >= 0 && problem.empty()) {
+            G4bool bound = true;
+            for (G4int c = 0; c < 7; ++c) {
+                bound = bound && reader->SetNtupleDColumn(convergence, kConvergenceColumns[c], convergenceValues[c]);
+            }
+            if (!bound) problem = "Convergence columns differ";
+        }
+
+        if (!problem.empty()) {
+            std::cerr << "[merge] " << fileName << ": " << problem << ", skipped" << std::endl;
+            reader->CloseFiles();
+            continue;
+        }
+
+        // the output takes its layout from the first accepted file
+        if (!booked) {
+            BookOutput(out, reader->GetH1(hitId), reader->GetH1(eventId));
+            for (G4int i = 0; i < kNOptional; ++i) {
+                if (fileOptional[i] < 0) continue;
+                auto h1 = reader->GetH1(fileOptional[i]);
+                optionalIds[i] = out->CreateH1(kOptional[i].name, kOptional[i].title, h1->axis().bins(),
+                                               h1->axis().lower_edge(), h1->axis().upper_edge());
+            }
+            out->OpenFile(argv[1]);
+            booked = true;
+        }
+
+        // --- add the whole file
+        out->GetH1(0)->add(*reader->GetH1(hitId));
+        out->GetH1(1)->add(*reader->GetH1(eventId));
+        for (G4int i = 0; i < kNOptional; ++i) {
+            if (optionalIds[i] >= 0) out->GetH1(optionalIds[i])->add(*reader->GetH1(fileOptional[i]));
+        }
+
+        // events of this file, for the EventID offset of the next one
+        G4double fileEvents = 0.;
+        if (runInfo >= 0) {
+            while (reader->GetNtupleRow(runInfo)) {
+                fileEvents += run.nEvents;
+                out->FillNtupleDColumn(3, 0, run.nEvents);
+                out->FillNtupleIColumn(3, 1, run.jobIndex);
+                out->FillNtupleIColumn(3, 2, run.nJobs);
+                out->FillNtupleDColumn(3, 3, run.seed);
+                out->AddNtupleRow(3);
+            }
+        }
+        G4int maxEventID = -1;
+
+        if (hits >= 0) {
+            while (reader->GetNtupleRow(hits)) {
+                maxEventID = std::max(maxEventID, hit.eventID);
+                out->FillNtupleDColumn(0, 0, hit.eventID + eventOffset);
+                out->FillNtupleFColumn(0, 1, hit.energy);
+                out->FillNtupleIColumn(0, 2, hit.trackID);
+                out->FillNtupleIColumn(0, 3, hit.pdg);
+                out->FillNtupleDColumn(0, 4, hit.time);
+                out->FillNtupleFColumn(0, 5, hit.weight);
+                out->AddNtupleRow(0);
+            }
+        }
+
+        if (events >= 0) {
+            while (reader->GetNtupleRow(events)) {
+                maxEventID = std::max(maxEventID, event.eventID);
+                out->FillNtupleDColumn(1, 0, event.eventID + eventOffset);
+                out->FillNtupleFColumn(1, 1, event.energy);
+                out->FillNtupleIColumn(1, 2, event.nHits);
+                out->FillNtupleFColumn(1, 3, event.weight);
+                out->FillNtupleIColumn(1, 4, event.sourceLayer);
+                out->FillNtupleIColumn(1, 5, event.sourcePDG);
+                out->AddNtupleRow(1);
+            }
+        }
+
+        if (tracks >= 0) {
+            while (reader->GetNtupleRow(tracks)) {
+                maxEventID = std::max(maxEventID, track.eventID);
+                out->FillNtupleDColumn(4, 0, track.eventID + eventOffset);
+                out->FillNtupleIColumn(4, 1, track.trackID);
+                out->FillNtupleIColumn(4, 2, track.pdg);
+                out->FillNtupleFColumn(4, 3, track.energy);
+                for (G4int c = 0; c < 5; ++c) out->FillNtupleFColumn(4, 4 + c, track.length[c]);
+                out->FillNtupleIColumn(4, 9, track.finalVolume);
+                out->AddNtupleRow(4);
+            }
+        }
+
+        if (convergence >= 0) {
+            while (reader->GetNtupleRow(convergence)) {
+                for (G4int c = 0; c < 7; ++c) out->FillNtupleDColumn(2, c, convergenceValues[c]);
+                out->AddNtupleRow(2);
+            }
+        }
+
+        // files without RunInfo: the largest EventID seen bounds the events
+        if (fileEvents <= 0.) fileEvents = maxEventID + 1;
+        std::cerr << "[merge] " << fileName << ": " << fileEvents << " events, EventID offset "
+                  << eventOffset << std::endl;
+        eventOffset += fileEvents;
+        totalEvents += fileEvents;
+        ++merged;
+
+        // drops this file's histograms and ntuples from the reader
+        reader->CloseFiles();
+    }
+
+    if (!booked) {
+        std::cerr << "[merge] No input file could be merged" << std::endl;
+        return 1;
+    }
+    out->Write();
+    out->CloseFile();
+    std::cerr << "[merge] " << merged << " of " << argc - 2 << " files, " << totalEvents << " events -> "
+              << argv[1] << std::endl;
+    return 0;
+}
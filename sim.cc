@@ -1,11 +1,17 @@
 #include <iostream>
 #include <filesystem>
+#include <cstdlib>
+#include <chrono>
 
+#include "G4RunManagerFactory.hh"
 #include "G4RunManager.hh"
 #include "G4UImanager.hh"
 #include "G4VisExecutive.hh"
 #include "G4UIExecutive.hh"
 #include "G4AnalysisManager.hh"
+#include "G4Threading.hh"
+#include "G4Timer.hh"
+#include "Randomize.hh"
 
 // physics list
 #include "G4EmLivermorePhysics.hh"
@@ -14,41 +20,204 @@
 #include "G4VModularPhysicsList.hh"
 #include "G4HadronElasticPhysics.hh"
 #include "G4PhysListFactory.hh"
+#include "G4GeometrySampler.hh"
+#include "G4ImportanceBiasing.hh"
+#include "G4FastSimulationPhysics.hh"
 
 // detector shielding file
 #include "detectorShielding.hh"
+#include "physicsList.hh"
 #include "action.hh"
+#include "sourceConfig.hh"
+#include "responseCache.hh"
+#include "sweep.hh"
+#include "decayChain.hh"
+#include "trackCuts.hh"
+#include "convergence.hh"
+#include "runOptions.hh"
+#include "phaseSpace.hh"
+#include "stepProfiler.hh"
+#include "fluxTally.hh"
+#include "pointKernel.hh"
+#include "asyncWriter.hh"
+#include "sourceModel.hh"
+#include "physicsTableCache.hh"
+#include "leadTransport.hh"
+#include "nextEvent.hh"
+#include "generator.hh"
 
 int main(int argc, char** argv)
 {
+    MyPrimaryGenerator::SetProcessStart(std::chrono::steady_clock::now());
+
+    RunOptions options;
+    if (!ParseRunOptions(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+    if (options.help) {
+        PrintUsage();
+        return 0;
+    }
+    const G4String& macroFile = options.macroFile;
+    const G4String& physics = options.physics;
+    G4int nThreads = options.nThreads;
+
+    G4RunManagerType runType = G4RunManagerType::SerialOnly;
+    if (options.mode == "mt") {
+        runType = G4RunManagerType::MTOnly;
+    } else if (options.mode == "tasking") {
+        runType = G4RunManagerType::TaskingOnly;
+    } else if (options.mode.empty() && nThreads > 1) {
+        runType = G4RunManagerType::Tasking;
+    }
+
     G4UIExecutive* ui = nullptr;
-    if (argc == 1) {
+    if (macroFile.empty()) {
         ui = new G4UIExecutive(argc, argv);
     }
 
     // Run manager
-    auto runManager = new G4RunManager();
+    auto runManager = G4RunManagerFactory::CreateRunManager(runType);
+    if (runType != G4RunManagerType::SerialOnly) {
+        if (nThreads <= 0) nThreads = G4Threading::G4GetNumberOfCores();
+        runManager->SetNumberOfThreads(nThreads);
+        G4cout << "[Run] " << G4RunManagerFactory::GetName(runType) << " run manager with "
+               << nThreads << " threads" << G4endl;
+    }
 
     // Create detector FIRST
     auto detector = new detectorShielding();
     runManager->SetUserInitialization(detector);
+    if (!options.resume.empty()) detector->SetResumeCheckpoint(options.resume);
 
     // Physics list
-    G4PhysListFactory factory;
-    G4VModularPhysicsList* physList = factory.GetReferencePhysList("FTFP_BERT");
-    //physList->RegisterPhysics(new G4EmLivermorePhysics());
-    //physList->RegisterPhysics(new G4DecayPhysics());
-    physList->RegisterPhysics(new G4RadioactiveDecayPhysics());
+    G4VModularPhysicsList* physList = nullptr;
+    G4String physicsName;
+    if (physics == "ftfp") {
+        G4PhysListFactory factory;
+        physList = factory.GetReferencePhysList("FTFP_BERT");
+        physList->RegisterPhysics(new G4RadioactiveDecayPhysics());
+        physicsName = "FTFP_BERT+RDM";
+    } else {
+        // lean low-energy list, no hadronic physics
+        physList = new MyPhysicsList(physics);
+        physicsName = physics == "option4" ? "EMopt4+RDM" : "Livermore+RDM";
+    }
+    ResponseCache::SetPhysicsListName(physicsName);
+
+    // Importance biasing of gammas in the mass geometry: splitting/roulette at
+    // the sub-slab boundaries set with /Shielding/biasing/importance
+    G4GeometrySampler* sampler = nullptr;
+    if (options.biasing) {
+        sampler = new G4GeometrySampler(detector->GetWorldVolume(), "gamma");
+        sampler->SetParallel(false);
+        physList->RegisterPhysics(new G4ImportanceBiasing(sampler));
+        detector->SetImportanceBiasing(true);
+        MyRunAction::SetImportanceBiasing(true);
+        G4cout << "[Run] Gamma importance biasing enabled; split copies of a history share its event, "
+               << "so EventEnergy and the Events ntuple are not filled (use the weighted HitEnergy and Hits)"
+               << G4endl;
+    }
+    // gammas can be handed to the Pb2 fast-simulation model (/Shielding/fastPb2/);
+    // only with --fast-pb2, so analogue runs do not pay for the fast-simulation
+    // process on every gamma step
+    if (options.fastPb2) {
+        auto fastSimulation = new G4FastSimulationPhysics();
+        fastSimulation->ActivateFastSimulation("gamma");
+        physList->RegisterPhysics(fastSimulation);
+    }
     runManager->SetUserInitialization(physList);
 
-    runManager->SetUserInitialization(new MyActionInitialization(detector));
+    // histograms and ntuples are booked per thread by MyRunAction
+    // shared vertex placement settings (/Shielding/source/)
+    auto source = new SourceConfig(detector);
+    // (layer, isotope) response recording (/Shielding/response/)
+    auto response = new ResponseCache(detector);
+    response->SetPhysicsList(physList);
+    response->SetSourceConfig(source);
+    // thickness/cavity scans in one process (/Shielding/sweep/)
+    auto sweep = new ShieldingSweep(detector);
+    // one equilibrium-chain member decay per event (/Shielding/chain/)
+    auto chain = new DecayChain();
+    response->SetDecayChain(chain);
+    // early kill of undetectable secondaries (/Shielding/stack/)
+    auto cuts = new TrackCuts();
+    response->SetTrackCuts(cuts);
+    // stop runs once the ROIs have converged (/Shielding/roi/)
+    auto convergence = new ConvergenceMonitor();
+    detector->SetConvergenceMonitor(convergence);
+    // two-stage runs through a boundary phase-space file (/Shielding/phaseSpace/)
+    auto phaseSpace = new PhaseSpace(detector);
+    response->SetPhaseSpace(phaseSpace);
+    // steps and time per (volume, particle, process) (/Shielding/profile/)
+    auto profiler = new StepProfiler();
+    // track-length flux per layer (/Shielding/flux/)
+    auto flux = new FluxTally(detector);
+    // Hits/Events/Tracks rows written from a thread per worker (/Shielding/writer/)
+    auto writer = new AsyncWriter();
+    detector->SetAsyncWriter(writer);
+    flux->SetAsyncWriter(writer);
+    // all (layer, nuclide) sources in one run (/Shielding/model/)
+    auto model = new SourceModel(detector);
+    detector->SetSourceModel(model);
+    // analytic line rates for shield screening (/Shielding/pointKernel/)
+    auto pointKernel = new PointKernel(detector);
+    // parameterised photon transport through Pb2 (/Shielding/fastPb2/)
+    auto leadTransport = new LeadTransport(detector);
+    if (options.fastPb2) {
+        detector->SetLeadTransport(leadTransport);
+        leadTransport->SetModelAttached(true);
+    }
+    // expected first interactions in the HPGe (/Shielding/nextEvent/)
+    auto nextEvent = new NextEventEstimator(detector, leadTransport);
+
+    runManager->SetUserInitialization(new MyActionInitialization(detector, source, response, chain, cuts,
+                                                                 convergence, phaseSpace, profiler,
+                                                                 flux, writer, model, leadTransport,
+                                                                 nextEvent));
 
     auto analysisManager = G4AnalysisManager::Instance();
     G4UImanager* UImanager = G4UImanager::GetUIpointer();
 
+    // split jobs: independent, reproducible engine streams and per-job files
+    // (/random/setSeeds in a macro still overrides the seeds)
+    if (options.seedSet || options.nJobs > 1) {
+        long seeds[3];
+        DeriveJobSeeds(options.seed, options.jobIndex, seeds);
+        G4Random::setTheSeeds(seeds);
+        G4cout << "[Run] Job " << options.jobIndex << "/" << options.nJobs << ", seed " << options.seed
+               << " -> engine seeds " << seeds[0] << " " << seeds[1] << G4endl;
+    }
+    if (!options.output.empty()) {
+        analysisManager->SetFileName(options.output);
+    }
+    MyRunAction::SetJob(options.jobIndex, options.nJobs, options.seed, JobSuffix(options));
+    // a checkpoint only resumes the same configuration and job
+    detector->SetRunConfiguration(response);
+    detector->SetJobKey(std::to_string(options.jobIndex) + "/" + std::to_string(options.nJobs) + " seed "
+                        + std::to_string(options.seed));
+
+    // geometry and physics construction; the physics tables themselves are
+    // built at the first beamOn, whose set-up the master run action reports
+    G4Timer initTimer;
+    initTimer.Start();
+    runManager->Initialize();
+    initTimer.Stop();
+    G4cout << "[Run] Initialisation with physics '" << physics << "' took "
+           << initTimer.GetRealElapsed() << " s (physics tables are built at the first beamOn)" << G4endl;
+    if (!ui) MyRunAction::SetStartUp(initTimer.GetRealElapsed());
+
+    // physics tables stored by an earlier process (--fast-start), looked up
+    // when the first beamOn builds them
+    PhysicsTableCache* tableCache = nullptr;
+    if (!options.fastStart.empty()) {
+        tableCache = new PhysicsTableCache(options.fastStart, physicsName);
+        tableCache->Prepare(physList);
+    }
+
     if (ui) {
         // INTERACTIVE MODE: Set up visualization
-        runManager->Initialize();
         auto visManager = new G4VisExecutive();
         visManager->Initialize();
         UImanager->ApplyCommand("/control/macroPath /home/bmiles/miniconda3/envs/geant4_env/share/Geant4/bramGeant4/hPGeShield/macros");
@@ -60,49 +229,40 @@ int main(int argc, char** argv)
         delete ui;
         delete visManager;
     } else {
-        // Create output file name - will be overridden by macro if specified
-        G4String outputdir = "/home/bmiles/miniconda3/envs/geant4_env/share/Geant4/bramGeant4/hPGeShield/root/";
-        G4String outputFileName = "default.root";
-        analysisManager->SetFileName(outputdir + outputFileName);
-
-        // Create histograms
-        analysisManager->CreateH1("HitEnergy", "Energy per Hit in HPGe", 6000, 0., 3.*MeV);
-        analysisManager->CreateH1("EventEnergy", "Total Energy per Event in HPGe", 6000, 0., 3.*MeV);
-
-        // Create ntuple for detailed hit information
-        analysisManager->CreateNtuple("Hits", "Individual Hit Data");
-        analysisManager->CreateNtupleDColumn("Energy");          // 0: Energy (MeV)
-        analysisManager->CreateNtupleDColumn("Energy_keV");      // 1: Energy (keV)  
-        analysisManager->CreateNtupleDColumn("TrackID");         // 2: Track ID
-        analysisManager->CreateNtupleSColumn("Particle");        // 3: Particle type
-        analysisManager->CreateNtupleDColumn("Time_ns");         // 4: Time of hit (ns)
-        analysisManager->FinishNtuple();                         // Ntuple ID 0
-
-        // Create ntuple for event summary
-        analysisManager->CreateNtuple("Events", "Event Summary");
-        analysisManager->CreateNtupleDColumn("EventID");         // 0: Event ID
-        analysisManager->CreateNtupleDColumn("TotalEnergy");     // 1: Total energy (MeV)
-        analysisManager->CreateNtupleDColumn("TotalEnergy_keV"); // 2: Total energy (keV)
-        analysisManager->CreateNtupleDColumn("NHits");           // 3: Number of hits
-        analysisManager->FinishNtuple();                         // Ntuple ID 1
         // =======================================================================
-        G4cout << "ROOT analysis set up. Output file: " << outputFileName << G4endl;
+        G4cout << "ROOT analysis set up. Output file: " << analysisManager->GetFileName() << G4endl;
         // =======================================================================
-        runManager->Initialize();
         UImanager->ApplyCommand("/control/macroPath /home/bmiles/miniconda3/envs/geant4_env/share/Geant4/bramGeant4/hPGeShield/macros");
         G4String command = "/control/execute ";
-        G4String fileName = argv[1];
         // BATCH MODE: No visualization, just execute the macro
-        UImanager->ApplyCommand(command + fileName);
-        G4cout << "Batch mode: Executing macro " << fileName << G4endl;
+        UImanager->ApplyCommand(command + macroFile);
+        G4cout << "Batch mode: Executing macro " << macroFile << G4endl;
         G4cout << "Visualization disabled for high-statistics run" << G4endl;
 
-        analysisManager->Write();
-        analysisManager->CloseFile();
+        // output is written and closed by MyRunAction at the end of each run
         //system(("ls -lh " + outputdir).c_str());
-        G4cout << "ROOT output written to " << analysisManager->GetFileName() << G4endl;
     }
 
+    // before the run manager, whose state manager would otherwise delete
+    // the cache as one of its state dependents
+    if (tableCache) tableCache->Store();
+    delete tableCache;
+
     delete runManager;
+    delete source;
+    delete response;
+    delete sweep;
+    delete chain;
+    delete cuts;
+    delete convergence;
+    delete phaseSpace;
+    delete profiler;
+    delete flux;
+    delete pointKernel;
+    delete writer;
+    delete model;
+    delete leadTransport;
+    delete nextEvent;
+    delete sampler;
     return 0;
 }
\ No newline at end of file
@@ -1,15 +1,43 @@
 #include "detectorShielding.hh"
 #include "generator.hh"
 #include "action.hh"
+#include "stacking.hh"
+#include "tracking.hh"
+#include "event.hh"
+#include "stepping.hh"
 #include "G4RunManager.hh"
 
-MyActionInitialization::MyActionInitialization(detectorShielding* det)
-    : fDet(det)
+MyActionInitialization::MyActionInitialization(detectorShielding* det, SourceConfig* source,
+                                               ResponseCache* response, DecayChain* chain,
+                                               TrackCuts* cuts, ConvergenceMonitor* convergence,
+                                               PhaseSpace* phaseSpace, StepProfiler* profiler,
+                                               FluxTally* flux, AsyncWriter* writer,
+                                               SourceModel* model, LeadTransport* transport,
+                                               NextEventEstimator* nextEvent)
+    : fDet(det), fSource(source), fResponse(response), fChain(chain), fCuts(cuts),
+      fConvergence(convergence), fPhaseSpace(phaseSpace), fProfiler(profiler), fFlux(flux),
+      fWriter(writer), fModel(model), fTransport(transport), fNextEvent(nextEvent)
 {}
 
 MyActionInitialization::~MyActionInitialization()
 {}
 
+void MyActionInitialization::BuildForMaster() const {
+    // master only opens, merges and writes the output file
+    SetUserAction(new MyRunAction(nullptr, nullptr, nullptr, fResponse, fConvergence, fPhaseSpace,
+                                  fProfiler, fFlux, fWriter, fModel, fTransport, fNextEvent));
+}
+
 void MyActionInitialization::Build() const {
-    SetUserAction(new MyPrimaryGenerator(fDet));
+    auto generator = new MyPrimaryGenerator(fDet, fSource, fChain, fPhaseSpace, fModel, fTransport);
+    auto stacking = new MyStackingAction(fDet, fChain, fModel, fCuts);
+    auto tracking = new MyTrackingAction(fProfiler, fFlux);
+    SetUserAction(generator);
+    SetUserAction(stacking);
+    SetUserAction(tracking);
+    auto run = new MyRunAction(generator, stacking, tracking, fResponse, fConvergence,
+                               fPhaseSpace, fProfiler, fFlux, fWriter, fModel, fTransport, fNextEvent);
+    SetUserAction(new MySteppingAction(fPhaseSpace, fProfiler, fFlux, fTransport, fNextEvent));
+    SetUserAction(new MyEventAction(fDet, run, fConvergence, fFlux, fWriter, fTransport, fNextEvent));
+    SetUserAction(run);
 }
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include "aliasTable.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+
+AliasTable::AliasTable()
+    : fTotalWeight(0.)
+{}
+
+AliasTable::~AliasTable()
+{}
+
+G4bool AliasTable::Build(const std::vector<G4double>& weights)
+{
+    fProbability.clear();
+    fAlias.clear();
+    fTotalWeight = 0.;
+    for (auto w : weights) {
+        if (w > 0.) fTotalWeight += w;
+    }
+    if (fTotalWeight <= 0.) return false;
+
+    const G4int n = static_cast<G4int>(weights.size());
+    fProbability.resize(n);
+    fAlias.resize(n);
+
+    // scaled so that the mean bucket holds exactly 1
+    std::vector<G4int> small, large;
+    for (G4int i = 0; i < n; ++i) {
+        fProbability[i] = std::max(0., weights[i]) * n / fTotalWeight;
+        fAlias[i] = i;
+        (fProbability[i] < 1. ? small : large).push_back(i);
+    }
+
+    while (!small.empty() && !large.empty()) {
+        G4int s = small.back();
+        small.pop_back();
+        G4int l = large.back();
+        fAlias[s] = l;
+        fProbability[l] -= 1. - fProbability[s];
+        if (fProbability[l] < 1.) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // leftovers are 1 up to rounding
+    for (auto i : small) fProbability[i] = 1.;
+    for (auto i : large) fProbability[i] = 1.;
+    return true;
+}
+
+G4int AliasTable::Sample() const
+{
+    const G4int n = GetSize();
+    if (n == 0) return -1;
+
+    // integer part picks the bucket, the fraction decides bucket or alias
+    G4double u = G4UniformRand() * n;
+    G4int bucket = std::min(static_cast<G4int>(u), n - 1);
+    return (u - bucket < fProbability[bucket]) ? bucket : fAlias[bucket];
+}
@@ -0,0 +1,205 @@
+#include "asyncWriter.hh"
+
+#include "G4AnalysisManager.hh"
+
+#include <algorithm>
+#include <chrono>
+
+G4ThreadLocal AsyncWriter::Local* AsyncWriter::fLocal = nullptr;
+
+namespace {
+    // column types of the ntuples booked by MyRunAction, by ntuple ID; the
+    // master-only Convergence and RunInfo ntuples are not written here
+    const char* kColumnTypes[] = {
+        "IFIIDF",     // 0 Hits
+        "IFIFII",     // 1 Events
+        "",           // 2 Convergence
+        "",           // 3 RunInfo
+        "IIIFFFFFFI"  // 4 Tracks
+    };
+    const G4int kNNtuples = sizeof(kColumnTypes) / sizeof(kColumnTypes[0]);
+
+    // writer poll interval while the ring is empty
+    const auto kIdle = std::chrono::microseconds(100);
+}
+
+AsyncWriter::AsyncWriter()
+    : fEnabled(false),
+      fQueueDepth(16384),
+      fBatch(256),
+      fMessenger(nullptr)
+{
+    fMessenger = new G4GenericMessenger(this, "/Shielding/writer/", "Ntuple writer thread");
+
+    fMessenger->DeclareMethod("enable", &AsyncWriter::SetEnabled)
+        .SetGuidance("Write the Hits, Events and Tracks rows from a writer thread per worker (default false)")
+        .SetParameterName("enable", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("queueDepth", &AsyncWriter::SetQueueDepth)
+        .SetGuidance("Rows buffered per worker before the event loop waits, rounded up to a")
+        .SetGuidance("power of two (default 16384)")
+        .SetParameterName("records", false)
+        .SetRange("records>0")
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("batch", &AsyncWriter::SetBatch)
+        .SetGuidance("Rows the writer thread takes from the ring at a time (default 256)")
+        .SetParameterName("records", false)
+        .SetRange("records>0")
+        .SetToBeBroadcasted(false);
+}
+
+AsyncWriter::~AsyncWriter()
+{
+    delete fMessenger;
+}
+
+void AsyncWriter::SetQueueDepth(G4int records)
+{
+    fQueueDepth = 1;
+    while (fQueueDepth < static_cast<std::size_t>(records)) fQueueDepth <<= 1;
+}
+
+void AsyncWriter::Fill(const Record& record)
+{
+    auto manager = G4AnalysisManager::Instance();
+    const char* types = kColumnTypes[record.ntuple];
+    for (G4int column = 0; types[column]; ++column) {
+        G4double value = record.value[column];
+        switch (types[column]) {
+            case 'I': manager->FillNtupleIColumn(record.ntuple, column, static_cast<G4int>(value)); break;
+            case 'F': manager->FillNtupleFColumn(record.ntuple, column, static_cast<G4float>(value)); break;
+            default:  manager->FillNtupleDColumn(record.ntuple, column, value); break;
+        }
+    }
+    manager->AddNtupleRow(record.ntuple);
+}
+
+void AsyncWriter::AddRow(G4int ntuple, std::initializer_list<G4double> values)
+{
+    if (ntuple < 0 || ntuple >= kNNtuples || values.size() > kMaxColumns) {
+        G4Exception("AsyncWriter::AddRow", "BadRow", FatalException,
+                    "Row of an ntuple the writer does not know.");
+    }
+    Record record;
+    record.ntuple = ntuple;
+    std::copy(values.begin(), values.end(), record.value);
+
+    if (!fLocal) fLocal = new Local();
+    Local& local = *fLocal;
+    if (!fEnabled && !local.running) {
+        Fill(record);
+        return;
+    }
+    if (!local.running) Start(local);
+
+    // single producer: only this thread moves head
+    std::size_t head = local.head.load(std::memory_order_relaxed);
+    std::size_t tail = local.tail.load(std::memory_order_acquire);
+    if (head - tail > local.mask) {
+        auto start = std::chrono::steady_clock::now();
+        while (head - (tail = local.tail.load(std::memory_order_acquire)) > local.mask) {
+            std::this_thread::yield();
+        }
+        ++local.fullWaits;
+        local.waitSeconds += std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+    }
+    local.ring[head & local.mask] = record;
+    local.head.store(head + 1, std::memory_order_release);
+
+    ++local.records;
+    local.maxDepth = std::max(local.maxDepth, head + 1 - tail);
+}
+
+void AsyncWriter::Start(Local& local)
+{
+    if (local.ring.size() != fQueueDepth) local.ring.assign(fQueueDepth, Record());
+    local.mask = fQueueDepth - 1;
+    local.batch = static_cast<std::size_t>(fBatch);
+    local.handed.clear();
+    local.head.store(0, std::memory_order_relaxed);
+    local.tail.store(0, std::memory_order_relaxed);
+    local.stop.store(false, std::memory_order_relaxed);
+    local.records = local.fullWaits = local.batches = 0;
+    local.waitSeconds = 0.;
+    local.maxDepth = 0;
+
+    local.thread = std::thread(&AsyncWriter::Write, std::ref(local));
+    local.running = true;
+}
+
+void AsyncWriter::Write(Local& local)
+{
+    // single consumer: only this thread moves tail. It only copies records;
+    // the analysis manager belongs to the owning thread, see Collect
+    for (;;) {
+        std::size_t tail = local.tail.load(std::memory_order_relaxed);
+        std::size_t head = local.head.load(std::memory_order_acquire);
+        if (head == tail) {
+            // stop is set after the last row, so head is final once seen
+            if (local.stop.load(std::memory_order_acquire)
+                && local.head.load(std::memory_order_acquire) == tail) return;
+            std::this_thread::sleep_for(kIdle);
+            continue;
+        }
+        std::size_t end = tail + std::min(head - tail, local.batch);
+        {
+            G4AutoLock lock(&local.handMutex);
+            for (std::size_t i = tail; i < end; ++i) local.handed.push_back(local.ring[i & local.mask]);
+        }
+        local.tail.store(end, std::memory_order_release);
+        ++local.batches;
+    }
+}
+
+void AsyncWriter::Collect(Local& local)
+{
+    {
+        G4AutoLock lock(&local.handMutex);
+        local.handed.swap(local.filled);
+    }
+    for (const auto& record : local.filled) Fill(record);
+    local.filled.clear();
+}
+
+void AsyncWriter::EndOfEvent()
+{
+    if (fLocal && fLocal->running) Collect(*fLocal);
+}
+
+void AsyncWriter::Drain()
+{
+    if (!fLocal || !fLocal->running) return;
+    Local& local = *fLocal;
+
+    local.stop.store(true, std::memory_order_release);
+    local.thread.join();
+    local.running = false;
+    Collect(local);
+
+    G4AutoLock lock(&fMutex);
+    ++fTotal.threads;
+    fTotal.records += local.records;
+    fTotal.fullWaits += local.fullWaits;
+    fTotal.waitSeconds += local.waitSeconds;
+    fTotal.maxDepth = std::max(fTotal.maxDepth, local.maxDepth);
+    fTotal.batches += local.batches;
+}
+
+void AsyncWriter::BeginOfRun()
+{
+    G4AutoLock lock(&fMutex);
+    fTotal = Totals();
+}
+
+void AsyncWriter::EndOfRun() const
+{
+    if (!fEnabled || fTotal.threads == 0) return;
+
+    G4cout << "[Writer] " << fTotal.records << " rows from " << fTotal.threads << " threads in "
+           << fTotal.batches << " batches, queue depth " << fQueueDepth << ", peak "
+           << 100. * fTotal.maxDepth / fQueueDepth << " % full" << G4endl;
+    G4cout << "[Writer] Event loop waited on a full queue " << fTotal.fullWaits << " times, "
+           << fTotal.waitSeconds << " s (summed over threads)" << G4endl;
+}
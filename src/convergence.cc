@@ -0,0 +1,250 @@
+#include "convergence.hh"
+#include "G4RunManager.hh"
+#include "G4AnalysisManager.hh"
+#include "G4UnitsTable.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <sstream>
+#include <cmath>
+#include <limits>
+
+G4ThreadLocal ConvergenceMonitor::Tally* ConvergenceMonitor::fLocal = nullptr;
+
+namespace {
+    // seconds between projected time-to-target lines
+    const G4double kReportInterval = 30.;
+}
+
+ConvergenceMonitor::ConvergenceMonitor()
+    : fTargetPrecision(0.),
+      fTimeBudget(0.),
+      fChunk(1000),
+      fConverged(false),
+      fSeries(false),
+      fStarted(false),
+      fLastReport(0.),
+      fMessenger(nullptr)
+{
+    fMessenger = new G4GenericMessenger(this, "/Shielding/roi/", "Convergence-driven run termination");
+
+    // /Shielding/roi/add 600 620 keV
+    fMessenger->DeclareMethod("add", &ConvergenceMonitor::AddROI)
+        .SetGuidance("<lo> <hi> [unit]: EventEnergy window whose counts must converge")
+        .SetParameterName("window", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("clear", &ConvergenceMonitor::ClearROIs)
+        .SetGuidance("Remove all regions of interest")
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("precision", &ConvergenceMonitor::SetPrecision)
+        .SetGuidance("Stop when every ROI has this relative uncertainty (0: no target)")
+        .SetParameterName("relError", false)
+        .SetRange("relError>=0")
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethodWithUnit("timeBudget", "s", &ConvergenceMonitor::SetTimeBudget)
+        .SetGuidance("Stop after this wall-clock time (0: no budget)")
+        .SetParameterName("time", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("chunk", &ConvergenceMonitor::SetChunk)
+        .SetGuidance("Events per thread between merges of the ROI tallies (default 1000)")
+        .SetParameterName("events", false)
+        .SetRange("events>0")
+        .SetToBeBroadcasted(false);
+}
+
+ConvergenceMonitor::~ConvergenceMonitor()
+{
+    delete fMessenger;
+}
+
+void ConvergenceMonitor::AddROI(const G4String& input)
+{
+    std::istringstream is(input);
+    G4double lo = -1., hi = -1.;
+    G4String unit = "keV";
+    is >> lo >> hi >> unit;
+    if (lo < 0. || hi <= lo) {
+        G4Exception("ConvergenceMonitor::AddROI", "BadROI", JustWarning,
+                    "Usage: /Shielding/roi/add <lo> <hi> [unit], with 0 <= lo < hi");
+        return;
+    }
+    G4double scale = G4UnitDefinition::GetValueOf(unit);
+    fROILow.push_back(lo * scale);
+    fROIHigh.push_back(hi * scale);
+    G4cout << "[ROI] Added " << lo * scale / keV << "-" << hi * scale / keV << " keV" << G4endl;
+}
+
+void ConvergenceMonitor::ClearROIs()
+{
+    fROILow.clear();
+    fROIHigh.clear();
+}
+
+G4bool ConvergenceMonitor::IsActive() const
+{
+    return !fROILow.empty() && (fTargetPrecision > 0. || fTimeBudget > 0.);
+}
+
+G4double ConvergenceMonitor::GetElapsed() const
+{
+    return std::chrono::duration<G4double>(std::chrono::steady_clock::now() - fStart).count();
+}
+
+G4double ConvergenceMonitor::GetRelativeError(const Tally& tally, std::size_t roi) const
+{
+    if (tally.sumW[roi] <= 0.) return std::numeric_limits<G4double>::infinity();
+    return std::sqrt(tally.sumW2[roi]) / tally.sumW[roi];
+}
+
+G4double ConvergenceMonitor::GetWorstRelativeError() const
+{
+    G4double worst = 0.;
+    for (std::size_t i = 0; i < fROILow.size(); ++i) {
+        worst = std::max(worst, GetRelativeError(fTotal, i));
+    }
+    return worst;
+}
+
+void ConvergenceMonitor::BeginOfRun()
+{
+    // later sub-runs of a series carry on with its totals
+    if (fSeries && fStarted) return;
+    fStarted = true;
+
+    fTotal.sumW.assign(fROILow.size(), 0.);
+    fTotal.sumW2.assign(fROILow.size(), 0.);
+    fTotal.events = 0;
+    fConverged = false;
+    fStart = std::chrono::steady_clock::now();
+    fLastReport = 0.;
+
+    if (IsActive()) {
+        G4cout << "[ROI] Convergence mode: " << fROILow.size() << " ROI(s), target "
+               << fTargetPrecision * 100. << " %, time budget "
+               << (fTimeBudget > 0. ? std::to_string(fTimeBudget / s) + " s" : "none") << G4endl;
+    }
+}
+
+ConvergenceMonitor::Tally& ConvergenceMonitor::GetLocal()
+{
+    if (!fLocal) fLocal = new Tally();
+    if (fLocal->sumW.size() != fROILow.size()) {
+        fLocal->sumW.assign(fROILow.size(), 0.);
+        fLocal->sumW2.assign(fROILow.size(), 0.);
+        fLocal->events = 0;
+    }
+    return *fLocal;
+}
+
+void ConvergenceMonitor::EndOfEvent(Tally& local)
+{
+    ++local.events;
+
+    if (local.events >= fChunk) Flush();
+    if (fConverged) G4RunManager::GetRunManager()->AbortRun(true);
+}
+
+void ConvergenceMonitor::AddEvent(G4double energy, G4double weight)
+{
+    if (!IsActive()) return;
+    Tally& local = GetLocal();
+
+    // events without an ROI hit still count towards the variance
+    for (std::size_t i = 0; i < fROILow.size(); ++i) {
+        if (energy >= fROILow[i] && energy < fROIHigh[i]) {
+            local.sumW[i] += weight;
+            local.sumW2[i] += weight * weight;
+        }
+    }
+    EndOfEvent(local);
+}
+
+void ConvergenceMonitor::AddHits(const std::vector<G4double>& energies, const std::vector<G4double>& weights)
+{
+    if (!IsActive()) return;
+    Tally& local = GetLocal();
+
+    // the score of a history is the weight of all its hits in the ROI, so
+    // split copies add up and their correlation is in the variance
+    for (std::size_t i = 0; i < fROILow.size(); ++i) {
+        G4double score = 0.;
+        for (std::size_t hit = 0; hit < energies.size(); ++hit) {
+            if (energies[hit] >= fROILow[i] && energies[hit] < fROIHigh[i]) score += weights[hit];
+        }
+        local.sumW[i] += score;
+        local.sumW2[i] += score * score;
+    }
+    EndOfEvent(local);
+}
+
+void ConvergenceMonitor::BeginSeries()
+{
+    fSeries = true;
+    fStarted = false;
+}
+
+void ConvergenceMonitor::EndSeries()
+{
+    fSeries = false;
+    fStarted = false;
+}
+
+void ConvergenceMonitor::Flush()
+{
+    if (!IsActive() || !fLocal || fLocal->events == 0) return;
+
+    G4AutoLock lock(&fMutex);
+    for (std::size_t i = 0; i < fROILow.size() && i < fLocal->sumW.size(); ++i) {
+        fTotal.sumW[i] += fLocal->sumW[i];
+        fTotal.sumW2[i] += fLocal->sumW2[i];
+        fLocal->sumW[i] = 0.;
+        fLocal->sumW2[i] = 0.;
+    }
+    fTotal.events += fLocal->events;
+    fLocal->events = 0;
+
+    G4double worst = GetWorstRelativeError();
+    G4double elapsed = GetElapsed();
+    G4bool reached = fTargetPrecision > 0. && worst <= fTargetPrecision;
+    G4bool timeUp = fTimeBudget > 0. && elapsed >= fTimeBudget / s;
+    if ((reached || timeUp) && !fConverged) {
+        fConverged = true;
+        G4cout << "[ROI] " << (reached ? "Target precision reached" : "Time budget spent")
+               << " after " << fTotal.events << " events, " << elapsed << " s" << G4endl;
+    } else if (elapsed - fLastReport >= kReportInterval) {
+        // relative error scales as 1/sqrt(events)
+        fLastReport = elapsed;
+        G4cout << "[ROI] " << fTotal.events << " events, worst ROI " << worst * 100. << " %";
+        if (fTargetPrecision > 0. && std::isfinite(worst)) {
+            G4double remaining = elapsed * ((worst * worst) / (fTargetPrecision * fTargetPrecision) - 1.);
+            G4cout << ", projected " << remaining << " s to target";
+        }
+        G4cout << G4endl;
+    }
+}
+
+void ConvergenceMonitor::EndOfRun()
+{
+    if (!IsActive()) return;
+    Flush(); // sequential mode: the master is also the worker
+
+    auto analysisManager = G4AnalysisManager::Instance();
+    G4double elapsed = GetElapsed();
+    for (std::size_t i = 0; i < fROILow.size(); ++i) {
+        G4double relError = GetRelativeError(fTotal, i);
+        G4cout << "[ROI] " << fROILow[i] / keV << "-" << fROIHigh[i] / keV << " keV: "
+               << fTotal.sumW[i] << " counts, " << relError * 100. << " %" << G4endl;
+
+        analysisManager->FillNtupleDColumn(2, 0, fROILow[i] / keV);
+        analysisManager->FillNtupleDColumn(2, 1, fROIHigh[i] / keV);
+        analysisManager->FillNtupleDColumn(2, 2, fTotal.sumW[i]);
+        analysisManager->FillNtupleDColumn(2, 3, relError);
+        analysisManager->FillNtupleDColumn(2, 4, fTargetPrecision);
+        analysisManager->FillNtupleDColumn(2, 5, static_cast<G4double>(fTotal.events));
+        analysisManager->FillNtupleDColumn(2, 6, elapsed);
+        analysisManager->AddNtupleRow(2);
+    }
+}
@@ -0,0 +1,183 @@
+#include "decayChain.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <sstream>
+#include <cmath>
+
+namespace {
+    // members and branchings (decays per chain-head decay), head first
+    const std::vector<DecayChain::Member> kTh232Chain = {
+        {"Th232", 90, 232, 0., 1.},
+        {"Ra228", 88, 228, 0., 1.},
+        {"Ac228", 89, 228, 0., 1.},
+        {"Th228", 90, 228, 0., 1.},
+        {"Ra224", 88, 224, 0., 1.},
+        {"Rn220", 86, 220, 0., 1.},
+        {"Po216", 84, 216, 0., 1.},
+        {"Pb212", 82, 212, 0., 1.},
+        {"Bi212", 83, 212, 0., 1.},
+        {"Po212", 84, 212, 0., 0.6406},
+        {"Tl208", 81, 208, 0., 0.3594},
+    };
+
+    const std::vector<DecayChain::Member> kU238Chain = {
+        {"U238",   92, 238, 0., 1.},
+        {"Th234",  90, 234, 0., 1.},
+        {"Pa234m", 91, 234, 73.92*keV, 1.},
+        {"Pa234",  91, 234, 0., 0.0016},
+        {"U234",   92, 234, 0., 1.},
+        {"Th230",  90, 230, 0., 1.},
+        {"Ra226",  88, 226, 0., 1.},
+        {"Rn222",  86, 222, 0., 1.},
+        {"Po218",  84, 218, 0., 1.},
+        {"Pb214",  82, 214, 0., 1.},
+        {"Bi214",  83, 214, 0., 1.},
+        {"Po214",  84, 214, 0., 0.99979},
+        {"Tl210",  81, 210, 0., 0.00021},
+        {"Pb210",  82, 210, 0., 1.},
+        {"Bi210",  83, 210, 0., 1.},
+        {"Po210",  84, 210, 0., 1.},
+    };
+
+    // levels closer than this are the same state
+    const G4double kLevelTolerance = 1.*keV;
+}
+
+DecayChain::DecayChain()
+    : fChainName("none"),
+      fVersion(0),
+      fMessenger(nullptr)
+{
+    fMessenger = new G4GenericMessenger(this, "/Shielding/chain/", "Equilibrium decay chain source");
+
+    // /Shielding/chain/select Th232|U238|none
+    fMessenger->DeclareMethod("select", &DecayChain::SetChain)
+        .SetGuidance("Decay one member of the chain per event (none: plain GPS particle).")
+        .SetGuidance("The GPS particle is replaced by the sampled member ion; keep")
+        .SetGuidance("/process/had/rdm/thresholdForVeryLongDecayTime so Th232/U238 decay.")
+        .SetParameterName("chain", false)
+        .SetCandidates("Th232 U238 none")
+        .SetToBeBroadcasted(false);
+
+    // /Shielding/chain/split Ra226 Pb210
+    fMessenger->DeclareMethod("split", &DecayChain::SetBreakpoints)
+        .SetGuidance("Members starting a new sub-chain (broken equilibrium), e.g. Ra226 Pb210.")
+        .SetGuidance("Resets all sub-chain activities to 1.")
+        .SetParameterName("members", false)
+        .SetToBeBroadcasted(false);
+
+    // /Shielding/chain/activity Pb210 3.5
+    fMessenger->DeclareMethod("activity", &DecayChain::SetActivity)
+        .SetGuidance("<sub-chain head> <activity relative to equilibrium>; 0 drops the sub-chain")
+        .SetParameterName("head_activity", false)
+        .SetToBeBroadcasted(false);
+}
+
+DecayChain::~DecayChain()
+{
+    delete fMessenger;
+}
+
+void DecayChain::SetChain(const G4String& chain)
+{
+    fChainName = chain;
+    if (chain == "Th232") {
+        fMembers = kTh232Chain;
+    } else if (chain == "U238") {
+        fMembers = kU238Chain;
+    } else {
+        fMembers.clear();
+    }
+    fBreakpoints.clear();
+    fSegmentActivity.clear();
+    Rebuild();
+}
+
+void DecayChain::SetBreakpoints(const G4String& input)
+{
+    std::istringstream is(input);
+    std::vector<G4String> breakpoints;
+    G4String name;
+    while (is >> name) {
+        if (FindMember(name) < 0) {
+            G4Exception("DecayChain::SetBreakpoints", "BadMember", JustWarning,
+                        (name + " is not a member of the " + fChainName + " chain").c_str());
+            return;
+        }
+        breakpoints.push_back(name);
+    }
+    fBreakpoints = breakpoints;
+    fSegmentActivity.clear();
+    Rebuild();
+}
+
+void DecayChain::SetActivity(const G4String& input)
+{
+    std::istringstream is(input);
+    G4String head;
+    G4double activity = -1.;
+    is >> head >> activity;
+
+    G4int member = FindMember(head);
+    if (member < 0 || activity < 0. || (member > 0 && fSegment[member] == fSegment[member - 1])) {
+        G4Exception("DecayChain::SetActivity", "BadSegment", JustWarning,
+                    "Usage: /Shielding/chain/activity <sub-chain head> <activity >= 0>");
+        return;
+    }
+    fSegmentActivity[fSegment[member]] = activity;
+    Rebuild();
+}
+
+G4bool DecayChain::IsMember(G4int Z, G4int A, G4double excitation) const
+{
+    for (const auto& m : fMembers) {
+        if (m.Z == Z && m.A == A && std::abs(m.excitation - excitation) < kLevelTolerance) {
+            return true;
+        }
+    }
+    return false;
+}
+
+G4int DecayChain::FindMember(const G4String& name) const
+{
+    for (std::size_t i = 0; i < fMembers.size(); ++i) {
+        if (fMembers[i].name == name) return static_cast<G4int>(i);
+    }
+    return -1;
+}
+
+void DecayChain::Rebuild()
+{
+    // segment index per member; activities are reset when the split changes
+    // (equilibrium: every sub-chain at 1)
+    std::size_t nSegments = 1;
+    fSegment.assign(fMembers.size(), 0);
+    for (std::size_t i = 0; i < fMembers.size(); ++i) {
+        for (const auto& b : fBreakpoints) {
+            if (i > 0 && fMembers[i].name == b) ++nSegments;
+        }
+        fSegment[i] = static_cast<G4int>(nSegments) - 1;
+    }
+    if (fSegmentActivity.size() != nSegments) {
+        fSegmentActivity.assign(nSegments, 1.);
+    }
+
+    std::vector<G4double> weights(fMembers.size());
+    for (std::size_t i = 0; i < fMembers.size(); ++i) {
+        weights[i] = fMembers[i].branching * fSegmentActivity[fSegment[i]];
+    }
+    ++fVersion;
+
+    if (!fTable.Build(weights)) {
+        if (!fMembers.empty()) {
+            G4Exception("DecayChain::Rebuild", "NoActivity", JustWarning,
+                        "All sub-chain activities are zero, chain source disabled.");
+        }
+        G4cout << "[Chain] Equilibrium chain source disabled" << G4endl;
+        return;
+    }
+
+    G4cout << "[Chain] " << fChainName << ": " << fMembers.size() << " members in "
+           << nSegments << " sub-chain(s), " << GetDecaysPerHead()
+           << " member decays per chain-head decay" << G4endl;
+}
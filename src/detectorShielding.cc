@@ -11,11 +11,31 @@
 #include "radioImpurities.hh"
 #include "G4SDManager.hh"
 #include "sensitiveDetector.hh"
+#include "sourceModel.hh"
+#include "convergence.hh"
+#include "responseCache.hh"
+#include "physicsTableCache.hh"
+#include "leadFastModel.hh"
+#include "run.hh"
 #include "G4SubtractionSolid.hh"
 #include "G4PhysicalVolumeStore.hh"
 #include "G4RunManager.hh"
 #include "G4LogicalVolumeStore.hh"
+#include "G4SolidStore.hh"
+#include "G4GeometryManager.hh"
 #include "G4RotationMatrix.hh"
+#include "G4IStore.hh"
+#include "G4Region.hh"
+#include "G4ProductionCuts.hh"
+#include "G4AnalysisManager.hh"
+#include "G4UImanager.hh"
+#include "Randomize.hh"
+
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <cmath>
+#include <filesystem>
 
 // ------------------------------------------------------------
 // Constructor
@@ -43,6 +63,19 @@ detectorShielding::detectorShielding()
     layerMap["Pb1"] = 2;
     layerMap["Pb2"] = 3;
 
+    // created once and shared by every geometry rebuild
+    fHPGeRotation = new G4RotationMatrix();
+    fHPGeRotation->rotateX(90.0 * deg);
+
+    fVisAttributes = {
+        new G4VisAttributes(G4Colour(1,0,0,1)),          // HPGe
+        new G4VisAttributes(G4Colour(0.8,0.4,0.1,0.3)),  // Cu1
+        new G4VisAttributes(G4Colour(0.9,0.5,0.1,0.3)),  // Cu2
+        new G4VisAttributes(G4Colour(0.4,0.4,0.4,0.25)), // Pb1
+        new G4VisAttributes(G4Colour(0.2,0.2,0.2,0.2))   // Pb2
+    };
+    for (auto vis : fVisAttributes) vis->SetForceSolid(true);
+
     // Create UI messenger
     fMessenger = new G4GenericMessenger(this, "/Shielding/", "Shielding controls");
 
@@ -70,7 +103,38 @@ detectorShielding::detectorShielding()
     // /Shielding/autoBeamOn
     fMessenger->DeclareMethod("autoBeamOn",
             &detectorShielding::AutoBeamOn)
-        .SetGuidance("Automatically runs beamOn with the total computed decays.");
+        .SetGuidance("Automatically runs beamOn with the total computed decays.")
+        .SetGuidance("Budgets above maxEventsPerRun run as sub-runs <file>_subNNN.root,")
+        .SetGuidance("listed in <file>_subruns.txt as they complete.");
+
+    fMessenger->DeclareMethod("maxEventsPerRun", &detectorShielding::SetMaxEventsPerRun)
+        .SetGuidance("Largest beamOn issued by autoBeamOn and /Shielding/beamOn (default")
+        .SetGuidance("10000000); also a checkpoint interval, see sim --resume.")
+        .SetParameterName("events", false)
+        .SetRange("events>0");
+
+    // /Shielding/beamOn <events>: /run/beamOn with sub-runs and checkpoints
+    fMessenger->DeclareMethod("beamOn", &detectorShielding::BeamOn)
+        .SetGuidance("Run <events> like /run/beamOn, as sub-runs <file>_subNNN.root with a")
+        .SetGuidance("checkpoint after each when the events exceed maxEventsPerRun or a")
+        .SetGuidance("/Shielding/checkpoint/ interval is set; double so large counts parse.")
+        .SetParameterName("events", false)
+        .SetToBeBroadcasted(false);
+
+    fCheckpointMessenger = new G4GenericMessenger(this, "/Shielding/checkpoint/", "Sub-run checkpoints");
+
+    fCheckpointMessenger->DeclareMethod("events", &detectorShielding::SetCheckpointEvents)
+        .SetGuidance("Checkpoint autoBeamOn and /Shielding/beamOn at least every <events>")
+        .SetGuidance("(0: only every maxEventsPerRun, default)")
+        .SetParameterName("events", false)
+        .SetRange("events>=0")
+        .SetToBeBroadcasted(false);
+
+    fCheckpointMessenger->DeclareMethodWithUnit("time", "s", &detectorShielding::SetCheckpointTime)
+        .SetGuidance("End a sub-run and checkpoint after this wall-clock time (0: off,")
+        .SetGuidance("default); the series continues with the events left")
+        .SetParameterName("time", false)
+        .SetToBeBroadcasted(false);
     
     fMessenger->DeclareMethod("setDecays",
             &detectorShielding::SetTotalDecays)
@@ -112,11 +176,61 @@ detectorShielding::detectorShielding()
         &detectorShielding::SetCavityHalfZ)
         .SetGuidance("Set cavity half Z dimension in mm")
         .SetParameterName("halfZ", false);
+
+    fMessenger->DeclareMethod("checkOverlaps", &detectorShielding::SetCheckOverlaps)
+        .SetGuidance("Check every placement for overlaps when the geometry is built (default")
+        .SetGuidance("false); an existing geometry is checked straight away.")
+        .SetParameterName("check", false)
+        .SetToBeBroadcasted(false);
+
+    fBiasingMessenger = new G4GenericMessenger(this, "/Shielding/biasing/", "Importance biasing");
+
+    // /Shielding/biasing/importance Pb2 1 2 4 8
+    fBiasingMessenger->DeclareMethod("importance", &detectorShielding::SetLayerImportance)
+        .SetGuidance("<layer> <importances...>: split the layer into one sub-slab per value,")
+        .SetGuidance("listed from the outer face inwards. Needs sim -b. Layers left out take")
+        .SetGuidance("the importance of their configured neighbour; the world continues the outer")
+        .SetGuidance("face of Pb2, the cavity and HPGe the inner face of Cu1.")
+        .SetParameterName("layer_importances", false)
+        .SetToBeBroadcasted(false);
+
+    fGeometryMessenger = new G4GenericMessenger(this, "/Shielding/geometry/", "Shield geometry builder");
+
+    fGeometryMessenger->DeclareMethod("nested", &detectorShielding::SetNestedGeometry)
+        .SetGuidance("false: each layer is a G4SubtractionSolid shell placed in the World (default)")
+        .SetGuidance("true : layers are plain boxes nested Pb2 > Pb1 > Cu2 > Cu1 > Cavity > HPGe")
+        .SetParameterName("nested", false)
+        .SetToBeBroadcasted(false);
+
+    // per-region production cuts; /run/setCut only applies to the world
+    fRegionCut[0] = fRegionCut[1] = fRegionCut[2] = 0.7 * mm;
+    fCutsMessenger = new G4GenericMessenger(this, "/Shielding/cuts/", "Per-region production cuts");
+
+    fCutsMessenger->DeclareMethodWithUnit("HPGe", "mm", &detectorShielding::SetHPGeCut)
+        .SetGuidance("Production cut in the HPGe crystal (default 0.7 mm)")
+        .SetParameterName("cut", false)
+        .SetToBeBroadcasted(false);
+
+    fCutsMessenger->DeclareMethodWithUnit("copper", "mm", &detectorShielding::SetCopperCut)
+        .SetGuidance("Production cut in the Cu1/Cu2 layers (default 0.7 mm)")
+        .SetParameterName("cut", false)
+        .SetToBeBroadcasted(false);
+
+    fCutsMessenger->DeclareMethodWithUnit("lead", "mm", &detectorShielding::SetLeadCut)
+        .SetGuidance("Production cut in the Pb1/Pb2 layers (default 0.7 mm)")
+        .SetParameterName("cut", false)
+        .SetToBeBroadcasted(false);
 }
 
 detectorShielding::~detectorShielding()
 {
     delete fMessenger;
+    delete fBiasingMessenger;
+    delete fCheckpointMessenger;
+    delete fCutsMessenger;
+    delete fGeometryMessenger;
+    delete fHPGeRotation;
+    for (auto vis : fVisAttributes) delete vis;
 }
 
 // ------------------------------------------------------------
@@ -127,8 +241,19 @@ G4VPhysicalVolume* detectorShielding::Construct()
     if (fGeometryDirty) {
         G4cout << "[Shielding] Geometry parameters changed, cleaning up old geometry..." << G4endl;
         
-        G4PhysicalVolumeStore* pvStore = G4PhysicalVolumeStore::GetInstance();
-        pvStore->Clean();
+        // delete the previous volumes and solids; materials are cached by
+        // RadioImpurities, so physics tables stay valid across rebuilds
+        G4GeometryManager::GetInstance()->OpenGeometry();
+        // regions must not keep the logical volumes about to be deleted
+        for (auto region : {fRegions[0], fRegions[1], fRegions[2], fPb2Envelope}) {
+            if (!region) continue;
+            std::vector<G4LogicalVolume*> roots(region->GetRootLogicalVolumeIterator(),
+                region->GetRootLogicalVolumeIterator() + region->GetNumberOfRootVolumes());
+            for (auto logic : roots) region->RemoveRootLogicalVolume(logic, false);
+        }
+        G4PhysicalVolumeStore::GetInstance()->Clean();
+        G4LogicalVolumeStore::GetInstance()->Clean();
+        G4SolidStore::GetInstance()->Clean();
         
         fGeometryDirty = false;
         
@@ -149,23 +274,27 @@ G4VPhysicalVolume* detectorShielding::DefineVolumes()
     G4Material* Cu2Material = RadioImpurities::CreateImpureCopper();
     G4Material* Pb1Material = RadioImpurities::CreateLowBackgroundLead();
     G4Material* Pb2Material = RadioImpurities::CreateImpureLead();
+    fLayerMaterial[0] = Cu1Material;
+    fLayerMaterial[1] = Cu2Material;
+    fLayerMaterial[2] = Pb1Material;
+    fLayerMaterial[3] = Pb2Material;
 
     G4Material* Ge  = nist->FindOrBuildMaterial("G4_Ge");
     G4Material* Air = nist->FindOrBuildMaterial("G4_AIR");
 
-    // World
-    G4double worldSize = 300 * cm;
+    // World (large enough for the thickest shield of a sweep)
+    G4double maxOuter = std::max({fHPGeHeight + fCavityHalfX, fHPGeDiam + fCavityHalfY})
+        + fInnerCu1Thickness + fInnerCu2Thickness + fOuterPb1Thickness + fOuterPb2Thickness;
+    G4double worldSize = std::max(300 * cm, 2.2 * maxOuter);
     auto solidWorld = new G4Box("World", worldSize/2, worldSize/2, worldSize/2);
     auto logicWorld = new G4LogicalVolume(solidWorld, Air, "World");
     logicWorld->SetVisAttributes(G4VisAttributes::GetInvisible());
-    auto physWorld  = new G4PVPlacement(nullptr, {}, logicWorld, "World", nullptr, false, 0, true);
+    auto physWorld  = new G4PVPlacement(nullptr, {}, logicWorld, "World", nullptr, false, 0, fCheckOverlaps);
+    fWorldVolume = physWorld;
 
     // HPGe
     auto solidHPGe = new G4Tubs("HPGe", 0, fHPGeDiam, fHPGeHeight, 90.0 * deg, 360.0 * deg);
     auto logicHPGe = new G4LogicalVolume(solidHPGe, Ge, "HPGe");
-    auto rot = new G4RotationMatrix();
-    rot->rotateX(90.0 * deg);
-    new G4PVPlacement(rot, {}, logicHPGe, "HPGe", logicWorld, false, 0, true);
 
     // --------------------------------------------------------
     // Compute cubic shells
@@ -186,36 +315,112 @@ G4VPhysicalVolume* detectorShielding::DefineVolumes()
     G4double pb2_inner = pb1_outer;
     G4double pb2_outer = pb2_inner + fOuterPb2Thickness;
 
-    auto hpgeVis = new G4VisAttributes(G4Colour(1,0,0,1));
-    auto cu1Vis = new G4VisAttributes(G4Colour(0.8,0.4,0.1,0.3)); 
-    auto cu2Vis = new G4VisAttributes(G4Colour(0.9,0.5,0.1,0.3));   
-    auto pb1Vis = new G4VisAttributes(G4Colour(0.4,0.4,0.4,0.25)); 
-    auto pb2Vis = new G4VisAttributes(G4Colour(0.2,0.2,0.2,0.2));
-
-    hpgeVis->SetForceSolid(true);
-    cu1Vis->SetForceSolid(true);
-    cu2Vis->SetForceSolid(true);
-    pb1Vis->SetForceSolid(true);
-    pb2Vis->SetForceSolid(true);
+    // A layer is split into one sub-shell per configured importance. Sub-shells
+    // keep the layer name (GPS confinement, scoring) and use the sub-slab index,
+    // counted from the inside, as copy number.
+    // Shells are built from the outside in. Boolean geometry: every shell is a
+    // G4SubtractionSolid placed in the World. Nested geometry: every shell is a
+    // plain box placed in the one outside it, down to the cavity and the HPGe.
+    fImportanceCells.clear();
+    // A layer without importances of its own takes the value at the outer
+    // face of the nearest configured layer inside it, or at the inner face of
+    // the nearest one outside it when there is none inside, so only the
+    // configured steps split or roulette photons.
+    std::vector<G4double> importance[4];
+    for (G4int layer = 0; layer < 4; ++layer) {
+        importance[layer] = fLayerImportance[layer];
+        if (!importance[layer].empty()) continue;
+        G4double value = 1.;
+        G4bool found = false;
+        for (G4int inside = layer - 1; inside >= 0 && !found; --inside) {
+            if (fLayerImportance[inside].empty()) continue;
+            value = fLayerImportance[inside].front();
+            found = true;
+        }
+        for (G4int outside = layer + 1; outside < 4 && !found; ++outside) {
+            if (fLayerImportance[outside].empty()) continue;
+            value = fLayerImportance[outside].back();
+            found = true;
+        }
+        importance[layer].push_back(value);
+    }
+    // the cavity and the HPGe continue the innermost slab, the world the outermost
+    fInnerImportance = importance[0].back();
+    fOuterImportance = importance[3].front();
 
+    G4LogicalVolume* mother = logicWorld;
     auto makeShell = [&](G4String name, G4double inner, G4double outer, G4Material* material, G4VisAttributes* visAttr)
     {
-        auto outerBox = new G4Box(name+"_outer", outer, outer, outer);
-        auto innerBox = new G4Box(name+"_inner", inner, inner, inner);
-        auto shell = new G4SubtractionSolid(name, outerBox, innerBox);
-        auto logic = new G4LogicalVolume(shell, material, name);
-
-        logic->SetVisAttributes(visAttr);
-
-        new G4PVPlacement(nullptr, {}, logic, name, logicWorld, false, 0, true);
-        return logic;
+        const auto& importances = importance[layerMap[name]];
+        G4int nSlabs = std::max<G4int>(1, importances.size());
+        G4double slabThickness = (outer - inner) / nSlabs;
+
+        std::vector<G4LogicalVolume*> logics;
+        for (G4int i = nSlabs - 1; i >= 0; --i) {
+            G4double slabInner = inner + i * slabThickness;
+            G4double slabOuter = (i == nSlabs - 1) ? outer : slabInner + slabThickness;
+
+            G4VSolid* shell = nullptr;
+            if (fNestedGeometry) {
+                shell = new G4Box(name, slabOuter, slabOuter, slabOuter);
+            } else {
+                auto outerBox = new G4Box(name+"_outer", slabOuter, slabOuter, slabOuter);
+                auto innerBox = new G4Box(name+"_inner", slabInner, slabInner, slabInner);
+                shell = new G4SubtractionSolid(name, outerBox, innerBox);
+            }
+            auto logic = new G4LogicalVolume(shell, material, name);
+
+            logic->SetVisAttributes(visAttr);
+
+            auto phys = new G4PVPlacement(nullptr, {}, logic, name, mother, false, i, fCheckOverlaps);
+            if (fNestedGeometry) mother = logic;
+            fImportanceCells.push_back({phys, i, importances[nSlabs - 1 - i]});
+            logics.push_back(logic);
+        }
+        return logics;
     };
 
-    logicHPGe->SetVisAttributes(hpgeVis);
-    auto logicCu1 = makeShell("Cu1", cu1_inner, cu1_outer, Cu1Material, cu1Vis);
-    auto logicCu2 = makeShell("Cu2", cu2_inner, cu2_outer, Cu2Material, cu2Vis);
-    auto logicPb1 = makeShell("Pb1", pb1_inner, pb1_outer, Pb1Material, pb1Vis);
-    auto logicPb2 = makeShell("Pb2", pb2_inner, pb2_outer, Pb2Material, pb2Vis);
+    auto logicPb2 = makeShell("Pb2", pb2_inner, pb2_outer, Pb2Material, fVisAttributes[4]);
+    auto logicPb1 = makeShell("Pb1", pb1_inner, pb1_outer, Pb1Material, fVisAttributes[3]);
+    auto logicCu2 = makeShell("Cu2", cu2_inner, cu2_outer, Cu2Material, fVisAttributes[2]);
+    auto logicCu1 = makeShell("Cu1", cu1_inner, cu1_outer, Cu1Material, fVisAttributes[1]);
+
+    // the nested geometry needs an explicit air cavity around the HPGe, and
+    // so does importance biasing: in the boolean geometry the cavity would
+    // otherwise be the world cell outside the shield
+    fCavityVolume = nullptr;
+    if (fNestedGeometry || fImportanceBiasing) {
+        auto solidCavity = new G4Box("Cavity", cu1_inner, cu1_inner, cu1_inner);
+        auto logicCavity = new G4LogicalVolume(solidCavity, Air, "Cavity");
+        logicCavity->SetVisAttributes(G4VisAttributes::GetInvisible());
+        fCavityVolume = new G4PVPlacement(nullptr, {}, logicCavity, "Cavity", mother, false, 0, fCheckOverlaps);
+        mother = logicCavity;
+    }
+
+    logicHPGe->SetVisAttributes(fVisAttributes[0]);
+    fHPGeVolume = new G4PVPlacement(fHPGeRotation, {}, logicHPGe, "HPGe", mother, false, 0, fCheckOverlaps);
+
+    // regions with their own production cuts
+    const char* regionNames[3] = {"HPGeRegion", "CopperRegion", "LeadRegion"};
+    for (G4int i = 0; i < 3; ++i) {
+        if (!fRegions[i]) {
+            fRegions[i] = new G4Region(regionNames[i]);
+            fRegions[i]->SetProductionCuts(new G4ProductionCuts());
+            fRegions[i]->GetProductionCuts()->SetProductionCut(fRegionCut[i]);
+        }
+    }
+    fRegions[0]->AddRootLogicalVolume(logicHPGe);
+    for (auto logics : {logicCu1, logicCu2}) {
+        for (auto logic : logics) fRegions[1]->AddRootLogicalVolume(logic);
+    }
+    // Pb2 has a region of its own for the fast-simulation model, with the
+    // production cuts of the lead region
+    if (!fPb2Envelope) {
+        fPb2Envelope = new G4Region("Pb2Envelope");
+        fPb2Envelope->SetProductionCuts(fRegions[2]->GetProductionCuts());
+    }
+    for (auto logic : logicPb1) fRegions[2]->AddRootLogicalVolume(logic);
+    for (auto logic : logicPb2) fPb2Envelope->AddRootLogicalVolume(logic);
 
     G4cout << "=== Geometry Debug Info ===" << G4endl;
     G4cout << "World size: " << worldSize/cm << " cm" << G4endl;
@@ -323,6 +528,45 @@ G4double detectorShielding::GetLayerMass(const G4String& layer)
     return mass;
 }
 
+G4int detectorShielding::GetLayerIndex(const G4String& layer) const
+{
+    auto it = layerMap.find(layer);
+    return (it == layerMap.end()) ? -1 : it->second;
+}
+
+void detectorShielding::GetLayerBounds(G4int layer, G4double& inner, G4double& outer) const
+{
+    if (layer < 0 || layer > 3) {
+        G4Exception("GetLayerBounds", "BadLayer", FatalException, "Bad layer index.");
+    }
+
+    // same shell stacking as DefineVolumes
+    G4double thickness[4] = {fInnerCu1Thickness, fInnerCu2Thickness,
+                             fOuterPb1Thickness, fOuterPb2Thickness};
+
+    inner = std::max({fHPGeHeight + fCavityHalfX, fHPGeDiam + fCavityHalfY});
+    for (G4int i = 0; i < layer; ++i) {
+        inner += thickness[i];
+    }
+    outer = inner + thickness[layer];
+}
+
+G4double detectorShielding::GetHPGeVolume() const
+{
+    // G4Tubs with fHPGeDiam as radius and fHPGeHeight as half-length
+    return pi * fHPGeDiam * fHPGeDiam * 2. * fHPGeHeight;
+}
+
+G4String detectorShielding::GetGeometryKey() const
+{
+    std::ostringstream key;
+    key << "hpge" << fHPGeDiam/mm << "x" << fHPGeHeight/mm
+        << "_cav" << fCavityHalfX/mm << "x" << fCavityHalfY/mm << "x" << fCavityHalfZ/mm
+        << "_cu" << fInnerCu1Thickness/mm << "-" << fInnerCu2Thickness/mm
+        << "_pb" << fOuterPb1Thickness/mm << "-" << fOuterPb2Thickness/mm;
+    return key.str();
+}
+
 // ------------------------------------------------------------
 // Simulation time
 // ------------------------------------------------------------
@@ -358,7 +602,7 @@ void detectorShielding::SetLayerActivityForName(const G4String& name, G4double a
 {
     G4double mass = GetLayerMass(name);
     G4double activity = mass * activityPerKg;
-    G4int decays = static_cast<G4int>(activity * fSimTime);
+    G4long decays = std::llround(activity * fSimTime);
 
     G4cout << "[Shielding] Layer: " << name
            << ", Mass: " << mass << " kg"
@@ -367,6 +611,7 @@ void detectorShielding::SetLayerActivityForName(const G4String& name, G4double a
 
     G4cout << "[DEBUG] Before adding: fTotalDecays = " << fTotalDecays << G4endl;
     fTotalDecays += decays;
+    fLayerActivity[GetLayerIndex(name)] += activityPerKg;
     G4cout << "[DEBUG] After adding: fTotalDecays = " << fTotalDecays << G4endl;
 }
 
@@ -374,6 +619,10 @@ void detectorShielding::SetLayerActivityForName(const G4String& name, G4double a
 
 void detectorShielding::AutoBeamOn()
 {
+    if (fSourceModel && fSourceModel->HasEntries()) {
+        // the model's decays over the exposure replace the set*Activity ones
+        fTotalDecays = std::llround(fSourceModel->Prepare() * fSimTime);
+    }
     G4cout << "[AutoBeamOn] fTotalDecays = " << fTotalDecays << G4endl;
     
     if (fTotalDecays <= 0) {
@@ -381,11 +630,218 @@ void detectorShielding::AutoBeamOn()
                     "Total decays = 0. Did you set simulation time and activities?");
         return;
     }
+    RunSeries(fTotalDecays);
+}
 
-    G4cout << "[Shielding] AutoBeamOn launching: " 
-           << fTotalDecays << " events" << G4endl;
+void detectorShielding::BeamOn(G4double events)
+{
+    G4long total = std::llround(events);
+    if (total <= 0) {
+        G4Exception("detectorShielding::BeamOn", "NoEvents", JustWarning,
+                    "Usage: /Shielding/beamOn <events>, with events > 0");
+        return;
+    }
+    RunSeries(total);
+}
 
-    G4RunManager::GetRunManager()->BeamOn(fTotalDecays);
+G4bool detectorShielding::SubRunTimeUp() const
+{
+    return fSubRunTimed && std::chrono::steady_clock::now() >= fSubRunDeadline;
+}
+
+G4long detectorShielding::GetSubRunSize() const
+{
+    G4long size = fMaxEventsPerRun;
+    if (fCheckpointEvents > 0) size = std::min<G4long>(size, fCheckpointEvents);
+    return size;
+}
+
+void detectorShielding::RunSeries(G4long total)
+{
+    auto runManager = G4RunManager::GetRunManager();
+    const G4long subRunSize = GetSubRunSize();
+    if (total <= subRunSize && fCheckpointTime <= 0. && fResumeCheckpoint.empty()) {
+        G4cout << "[Shielding] Launching " << total << " events" << G4endl;
+        runManager->BeamOn(static_cast<G4int>(total));
+        return;
+    }
+
+    // Sub-runs of bounded size (and time), each closing its own file, so
+    // memory stays bounded and finished sub-runs survive a killed job
+    G4long nSubRuns = (total + subRunSize - 1) / subRunSize;
+    G4cout << "[Shielding] Launching " << total << " events in " << nSubRuns
+           << " sub-runs of at most " << subRunSize << " events";
+    if (fCheckpointTime > 0.) G4cout << " or " << fCheckpointTime / s << " s";
+    G4cout << G4endl;
+
+    // <file>_jobNNN in split jobs: sub-runs, index and checkpoint are per job
+    // and named like the files MyRunAction writes
+    G4String base = MyRunAction::GetJobBaseName(G4AnalysisManager::Instance()->GetFileName());
+
+    G4long firstSub = 0;
+    G4long remaining = total;
+    if (!fResumeCheckpoint.empty()) {
+        G4String checkpoint = fResumeCheckpoint;
+        fResumeCheckpoint = "";
+        if (!ReadCheckpoint(checkpoint, total, base, firstSub, remaining)) return;
+    }
+
+    std::ofstream index(base + "_subruns.txt", firstSub > 0 ? std::ios::app : std::ios::trunc);
+    if (firstSub == 0) index << "# subrun events file\n";
+
+    // the ROI target and time budget apply to the whole series
+    const G4bool converging = fConvergence && fConvergence->IsActive();
+    if (converging) fConvergence->BeginSeries();
+
+    G4UImanager* UImanager = G4UImanager::GetUIpointer();
+    for (G4long sub = firstSub; remaining > 0; ++sub) {
+        G4int events = static_cast<G4int>(std::min<G4long>(remaining, subRunSize));
+        std::ostringstream fileName;
+        fileName << base << "_sub" << std::setw(3) << std::setfill('0') << sub << ".root";
+
+        // broadcast so worker threads switch file too
+        UImanager->ApplyCommand("/analysis/setFileName " + fileName.str());
+        // workers stop at their next event once the deadline passed, see MyEventAction
+        fSubRunTimed = fCheckpointTime > 0.;
+        fSubRunDeadline = std::chrono::steady_clock::now()
+            + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<G4double>(fCheckpointTime / s));
+        runManager->BeamOn(events);
+        fSubRunTimed = false;
+        // fewer when the time interval, the convergence monitor or the user aborted the run
+        G4int done = runManager->GetCurrentRun() ? runManager->GetCurrentRun()->GetNumberOfEvent() : 0;
+        remaining -= done;
+        G4bool converged = converging && fConvergence->IsConverged();
+
+        index << sub << " " << done << " " << fileName.str() << "\n";
+        index.flush();
+        WriteCheckpoint(total, base, sub + 1, total - remaining, converged);
+        G4cout << "[Shielding] Sub-run " << sub + 1 << " done (" << fileName.str() << ", " << done
+               << " events), " << remaining << " events left" << G4endl;
+        if (converged) {
+            G4cout << "[Shielding] ROIs converged, the series ends after " << total - remaining
+                   << " of " << total << " events" << G4endl;
+            break;
+        }
+        if (done == 0) {
+            G4Exception("detectorShielding::RunSeries", "NoProgress", JustWarning,
+                        "A sub-run did no events; stopping the series.");
+            break;
+        }
+    }
+
+    if (converging) fConvergence->EndSeries();
+    UImanager->ApplyCommand("/analysis/setFileName " + base + ".root");
+}
+
+G4String detectorShielding::GetCheckpointKey() const
+{
+    // whatever changes the events of a sub-run: geometry, physics, cuts and
+    // source as keyed for cached responses, and the job's seed
+    std::ostringstream key;
+    key << "geometry " << GetGeometryKey() << "\n";
+    if (fConfiguration) key << fConfiguration->GetKeyText();
+    if (fSourceModel) {
+        for (const auto& entry : fSourceModel->GetEntries()) {
+            key << "model " << entry.layer << " " << entry.nuclide << " " << entry.activity << "\n";
+        }
+    }
+    key << "job " << fJobKey << "\n";
+    return PhysicsTableCache::HashText(key.str());
+}
+
+// A checkpoint is taken after every completed sub-run: the engine status
+// that seeds the next sub-run, the events done and the sub-run files written.
+// Everything scored so far is in the closed sub-run files, so nothing else
+// has to be saved. Resuming restores the engine and continues with the next
+// sub-run; with sub-runs of fixed size the set of sub-run files is the same
+// as for an uninterrupted job.
+void detectorShielding::WriteCheckpoint(G4long total, const G4String& base, G4long subRunsDone,
+                                        G4long eventsDone, G4bool converged) const
+{
+    G4String engineFile = base + "_checkpoint.rndm";
+    G4Random::saveEngineStatus(engineFile.c_str());
+
+    // written aside and renamed, so a kill never leaves half a checkpoint
+    G4String fileName = base + "_checkpoint.txt";
+    {
+        std::ofstream out(fileName + ".tmp");
+        out << "# HPGe-Boulby-Shielding sub-run checkpoint\n"
+            << "geometry " << GetGeometryKey() << "\n"
+            << "config " << GetCheckpointKey() << "\n"
+            << "total " << total << "\n"
+            << "perRun " << GetSubRunSize() << "\n"
+            << "base " << base << "\n"
+            << "subruns " << subRunsDone << "\n"
+            << "events " << eventsDone << "\n"
+            << "converged " << (converged ? 1 : 0) << "\n"
+            << "engine " << engineFile << "\n";
+    }
+    std::error_code ec;
+    std::filesystem::rename((fileName + ".tmp").c_str(), fileName.c_str(), ec);
+    if (ec) {
+        G4Exception("detectorShielding::WriteCheckpoint", "CheckpointFailed", JustWarning,
+                    ("Cannot write " + fileName).c_str());
+    }
+}
+
+G4bool detectorShielding::ReadCheckpoint(const G4String& fileName, G4long total, G4String& base,
+                                         G4long& subRunsDone, G4long& remaining) const
+{
+    std::ifstream in(fileName);
+    std::map<std::string, std::string> values;
+    std::string key, value;
+    while (in >> key) {
+        if (key[0] == '#') {
+            std::getline(in, value);
+            continue;
+        }
+        in >> value;
+        values[key] = value;
+    }
+
+    // the remaining sub-runs only match the finished ones for the same job:
+    // geometry, physics, cuts, source, seed, event budget and sub-run size
+    G4bool valid = values.count("subruns") && values.count("events") && values.count("engine")
+        && values["geometry"] == GetGeometryKey()
+        && values["config"] == GetCheckpointKey()
+        && values["total"] == std::to_string(total)
+        && values["perRun"] == std::to_string(GetSubRunSize());
+    if (!valid) {
+        G4Exception("detectorShielding::ReadCheckpoint", "BadCheckpoint", JustWarning,
+                    (fileName + " is missing or belongs to a different configuration, event budget"
+                     " or sub-run size; not resuming.").c_str());
+        return false;
+    }
+
+    base = values["base"];
+    subRunsDone = std::stoll(values["subruns"]);
+    remaining = total - std::stoll(values["events"]);
+    // the job ended on its ROI target: nothing left to do
+    if (values["converged"] == "1") remaining = 0;
+    G4Random::restoreEngineStatus(values["engine"].c_str());
+
+    G4cout << "[Shielding] Resuming from " << fileName << ": " << subRunsDone
+           << " sub-runs done, " << remaining << " events left" << G4endl;
+    return true;
+}
+
+void detectorShielding::SetCheckpointEvents(G4int events)
+{
+    fCheckpointEvents = events;
+    G4cout << "[Shielding] Checkpoint every " << events << " events" << G4endl;
+}
+
+void detectorShielding::SetCheckpointTime(G4double time)
+{
+    fCheckpointTime = time;
+    G4cout << "[Shielding] Checkpoint every " << time / s << " s" << G4endl;
+}
+
+void detectorShielding::SetMaxEventsPerRun(G4int events)
+{
+    fMaxEventsPerRun = events;
+    G4cout << "[Shielding] AutoBeamOn sub-run size set to " << events << " events" << G4endl;
 }
 
 // ------------------------------------------------------------
@@ -400,7 +856,7 @@ void detectorShielding::SetInnerCu1Thickness(G4double thickness)
     } else {
         fInnerCu1Thickness = thickness;
     }
-    fGeometryDirty = true;
+    GeometryChanged();
     G4cout << "[Shielding] Inner Cu1 thickness set to " << fInnerCu1Thickness/mm << " mm" << G4endl;
 }
 
@@ -413,7 +869,7 @@ void detectorShielding::SetInnerCu2Thickness(G4double thickness)
     } else {
         fInnerCu2Thickness = thickness;
     }
-    fGeometryDirty = true;
+    GeometryChanged();
     G4cout << "[Shielding] Inner Cu2 thickness set to " << fInnerCu2Thickness/mm << " mm" << G4endl;
 }
 
@@ -426,7 +882,7 @@ void detectorShielding::SetOuterPb1Thickness(G4double thickness)
     } else {
         fOuterPb1Thickness = thickness;
     }
-    fGeometryDirty = true;
+    GeometryChanged();
     G4cout << "[Shielding] Outer Pb1 thickness set to " << fOuterPb1Thickness/mm << " mm" << G4endl;
 }
 
@@ -439,7 +895,7 @@ void detectorShielding::SetOuterPb2Thickness(G4double thickness)
     } else {
         fOuterPb2Thickness = thickness;
     }
-    fGeometryDirty = true;
+    GeometryChanged();
     G4cout << "[Shielding] Outer Pb2 thickness set to " << fOuterPb2Thickness/mm << " mm" << G4endl;
 }
 
@@ -452,7 +908,7 @@ void detectorShielding::SetCavityHalfX(G4double halfX)
     } else {
         fCavityHalfX = halfX;
     }
-    fGeometryDirty = true;
+    GeometryChanged();
     G4cout << "[Shielding] Cavity half X set to " << fCavityHalfX/mm << " mm" << G4endl;
 }
 
@@ -465,7 +921,7 @@ void detectorShielding::SetCavityHalfY(G4double halfY)
     } else {
         fCavityHalfY = halfY;
     }
-    fGeometryDirty = true;
+    GeometryChanged();
     G4cout << "[Shielding] Cavity half Y set to " << fCavityHalfY/mm << " mm" << G4endl;
 }
 
@@ -478,17 +934,110 @@ void detectorShielding::SetCavityHalfZ(G4double halfZ)
     } else {
         fCavityHalfZ = halfZ;
     }
-    fGeometryDirty = true;
+    GeometryChanged();
     G4cout << "[Shielding] Cavity half Z set to " << fCavityHalfZ/mm << " mm" << G4endl;
 }
 
+void detectorShielding::GeometryChanged()
+{
+    // rebuilt by Construct() at the next beamOn; physics tables are kept
+    fGeometryDirty = true;
+    G4RunManager::GetRunManager()->ReinitializeGeometry();
+}
+
+void detectorShielding::SetLayerImportance(const G4String& input)
+{
+    std::istringstream is(input);
+    G4String layer;
+    is >> layer;
+
+    std::vector<G4double> importances;
+    G4double value;
+    while (is >> value) importances.push_back(value);
+
+    G4int index = GetLayerIndex(layer);
+    G4bool valid = index >= 0 && !importances.empty();
+    for (auto importance : importances) valid = valid && importance > 0.;
+    if (!valid) {
+        G4Exception("SetLayerImportance", "BadImportance", JustWarning,
+                    "Usage: /Shielding/biasing/importance <layer> <positive importances...>");
+        return;
+    }
+    if (!fImportanceBiasing) {
+        G4Exception("SetLayerImportance", "BiasingOff", JustWarning,
+                    "Importance biasing is not enabled (run sim with -b); only the sub-slabs are built.");
+    }
+
+    fLayerImportance[index] = importances;
+    GeometryChanged();
+    G4cout << "[Shielding] " << layer << " split into " << importances.size()
+           << " importance sub-slabs" << G4endl;
+}
+
+void detectorShielding::SetNestedGeometry(G4bool nested)
+{
+    if (nested == fNestedGeometry) return;
+    fNestedGeometry = nested;
+    G4cout << "[Shielding] " << (nested ? "Nested box" : "Boolean shell") << " geometry selected" << G4endl;
+    GeometryChanged();
+}
+
+void detectorShielding::SetCheckOverlaps(G4bool check)
+{
+    fCheckOverlaps = check;
+    if (!check || !fWorldVolume) return;
+
+    // the geometry already exists: check it now rather than at the next rebuild
+    G4int overlaps = 0;
+    G4int volumes = 0;
+    for (auto volume : *G4PhysicalVolumeStore::GetInstance()) {
+        if (volume == fWorldVolume) continue;
+        ++volumes;
+        if (volume->CheckOverlaps()) ++overlaps;
+    }
+    G4cout << "[Shielding] Overlap check: " << overlaps << " of " << volumes
+           << " placements overlap" << G4endl;
+}
+
+void detectorShielding::SetRegionCut(G4int region, G4double cut)
+{
+    fRegionCut[region] = cut;
+    // picked up by the production cuts table at the next beamOn
+    if (fRegions[region]) {
+        fRegions[region]->GetProductionCuts()->SetProductionCut(cut);
+    }
+    const char* names[3] = {"HPGe", "copper", "lead"};
+    G4cout << "[Shielding] Production cut in " << names[region] << " set to " << cut/mm << " mm" << G4endl;
+}
+
+void detectorShielding::CreateImportanceStore()
+{
+    // one store per thread, rebuilt with the geometry
+    G4IStore* istore = G4IStore::GetInstance();
+    istore->Clear();
+    istore->SetWorldVolume();
+
+    // leaving the shield outwards or entering the cavity changes nothing
+    istore->AddImportanceGeometryCell(fOuterImportance, *fWorldVolume);
+    istore->AddImportanceGeometryCell(fInnerImportance, *fHPGeVolume);
+    istore->AddImportanceGeometryCell(fInnerImportance, *fCavityVolume);
+    for (const auto& cell : fImportanceCells) {
+        istore->AddImportanceGeometryCell(cell.importance, *cell.volume, cell.copyNo);
+    }
+}
+
 void detectorShielding::ConstructSDandField()
 {
     G4SDManager* sdManager = G4SDManager::GetSDMpointer();
     
-    // Create sensitive detector for HPGe
-    SensitiveDetector* hpgeSD = new SensitiveDetector("HPGeSD");
-    sdManager->AddNewDetector(hpgeSD);
+    // Create sensitive detector for HPGe, or reuse it after a geometry rebuild
+    G4VSensitiveDetector* hpgeSD = sdManager->FindSensitiveDetector("HPGeSD", false);
+    if (!hpgeSD) {
+        hpgeSD = new SensitiveDetector("HPGeSD", fWriter);
+        sdManager->AddNewDetector(hpgeSD);
+    }
+    // split histories have no single event energy
+    static_cast<SensitiveDetector*>(hpgeSD)->SetEventScoring(!fImportanceBiasing);
     
     // Set the sensitive detector to the HPGe logical volume
     G4LogicalVolume* hpgeLV = G4LogicalVolumeStore::GetInstance()->GetVolume("HPGe");
@@ -499,13 +1048,24 @@ void detectorShielding::ConstructSDandField()
         G4Exception("detectorShielding::ConstructSDandField", "SD001", 
                    FatalException, "HPGe logical volume not found!");
     }
+
+    if (fImportanceBiasing) {
+        CreateImportanceStore();
+    }
+
+    // one model per thread, kept by the region across geometry rebuilds; only
+    // with sim --fast-pb2, and idle until /Shielding/fastPb2/enable and a
+    // table are in place
+    if (fLeadTransport && fPb2Envelope && !fPb2Envelope->GetFastSimulationManager()) {
+        new LeadFastModel(fPb2Envelope, fLeadTransport);
+    }
 }
 
-void detectorShielding::SetTotalDecays(G4int decays)
+void detectorShielding::SetTotalDecays(G4double decays)
 {
     if (decays < 0) decays = 0;
 
-    fTotalDecays = decays;
+    fTotalDecays = std::llround(decays);
 
     G4cout << "[Shielding] Total decays manually set to "
            << fTotalDecays << G4endl;
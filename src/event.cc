@@ -0,0 +1,59 @@
+#include "event.hh"
+#include "detectorShielding.hh"
+#include "convergence.hh"
+#include "fluxTally.hh"
+#include "asyncWriter.hh"
+#include "leadTransport.hh"
+#include "nextEvent.hh"
+#include "run.hh"
+#include "sensitiveDetector.hh"
+#include "G4SDManager.hh"
+#include "G4RunManager.hh"
+
+MyEventAction::MyEventAction(const detectorShielding* det, MyRunAction* run, ConvergenceMonitor* convergence,
+                             FluxTally* flux, AsyncWriter* writer, LeadTransport* transport,
+                             NextEventEstimator* nextEvent)
+    : fShielding(det),
+      fRun(run),
+      fConvergence(convergence),
+      fFlux(flux),
+      fWriter(writer),
+      fTransport(transport),
+      fNextEvent(nextEvent),
+      fDetector(nullptr)
+{}
+
+MyEventAction::~MyEventAction()
+{}
+
+void MyEventAction::EndOfEventAction(const G4Event*)
+{
+    // /Shielding/checkpoint/time: the series continues in the next sub-run
+    if (fShielding->SubRunTimeUp()) G4RunManager::GetRunManager()->AbortRun(true);
+
+    if (fFlux->IsEnabled()) fFlux->EndOfEvent();
+    if (fNextEvent->IsEnabled()) fNextEvent->EndOfEvent();
+    // rows of this and earlier events the writer thread has handed back
+    fWriter->EndOfEvent();
+    // calibration events never reach the HPGe and must not stop the run
+    if (fTransport->IsCalibrating()) {
+        fTransport->EndOfEvent();
+        return;
+    }
+
+    // the SD is kept across geometry rebuilds, see ConstructSDandField
+    if (!fDetector) {
+        fDetector = static_cast<SensitiveDetector*>(
+            G4SDManager::GetSDMpointer()->FindSensitiveDetector("HPGeSD", false));
+        if (!fDetector) return;
+    }
+    fRun->AddHistory(fDetector->GetHitEnergies(), fDetector->GetHitWeights(), fDetector->GetEventEnergy(),
+                     fDetector->IsEventScoring());
+
+    if (!fConvergence->IsActive()) return;
+    if (fDetector->IsEventScoring()) {
+        fConvergence->AddEvent(fDetector->GetEventEnergy(), 1.);
+    } else {
+        fConvergence->AddHits(fDetector->GetHitEnergies(), fDetector->GetHitWeights());
+    }
+}
@@ -0,0 +1,190 @@
+#include "fluxTally.hh"
+#include "detectorShielding.hh"
+#include "asyncWriter.hh"
+#include "G4AnalysisManager.hh"
+#include "G4EventManager.hh"
+#include "G4Event.hh"
+#include "G4Step.hh"
+#include "G4ParticleTable.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4UnitsTable.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
+
+#include <sstream>
+
+G4ThreadLocal FluxTally::Local* FluxTally::fLocal = nullptr;
+
+namespace {
+    const char* kLayerNames[FluxTally::kNLayers] = {"Cu1", "Cu2", "Pb1", "Pb2", "HPGe"};
+}
+
+FluxTally::FluxTally(const detectorShielding* det)
+    : fDetector(det),
+      fEnabled(false),
+      fParticleName("gamma"),
+      fNBins(300),
+      fEMax(3.*MeV),
+      fWriteTracks(false),
+      fWriter(nullptr),
+      fMessenger(nullptr)
+{
+    fMessenger = new G4GenericMessenger(this, "/Shielding/flux/", "Track-length flux tally per layer");
+
+    fMessenger->DeclareMethod("enable", &FluxTally::SetEnabled)
+        .SetGuidance("Tally track length per layer and energy bin (default false)")
+        .SetParameterName("enable", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("particle", &FluxTally::SetParticle)
+        .SetGuidance("Particle whose track length is tallied, or all (default gamma)")
+        .SetParameterName("particle", false)
+        .SetToBeBroadcasted(false);
+
+    // /Shielding/flux/binning 300 3 MeV
+    fMessenger->DeclareMethod("binning", &FluxTally::SetBinning)
+        .SetGuidance("<bins> <eMax> [unit]: energy bins of the Flux_<layer> histograms (default 300 3 MeV)")
+        .SetParameterName("binning", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("tracks", &FluxTally::SetWriteTracks)
+        .SetGuidance("Also write one Tracks ntuple row per tallied track (default false)")
+        .SetParameterName("write", false)
+        .SetToBeBroadcasted(false);
+}
+
+FluxTally::~FluxTally()
+{
+    delete fMessenger;
+}
+
+void FluxTally::SetBinning(const G4String& input)
+{
+    std::istringstream is(input);
+    G4int bins = 0;
+    G4double eMax = 0.;
+    G4String unit = "MeV";
+    is >> bins >> eMax >> unit;
+    if (bins <= 0 || eMax <= 0.) {
+        G4Exception("FluxTally::SetBinning", "BadBinning", JustWarning,
+                    "Usage: /Shielding/flux/binning <bins> <eMax> [unit]");
+        return;
+    }
+    fNBins = bins;
+    fEMax = eMax * G4UnitDefinition::GetValueOf(unit);
+}
+
+G4double FluxTally::GetLayerVolume(G4int layer) const
+{
+    if (layer == 4) return fDetector->GetHPGeVolume();
+    G4double inner, outer;
+    fDetector->GetLayerBounds(layer, inner, outer);
+    return 8. * (outer * outer * outer - inner * inner * inner);
+}
+
+void FluxTally::BeginOfRun()
+{
+    auto analysisManager = G4AnalysisManager::Instance();
+    for (G4int layer = 0; layer < kNLayers; ++layer) {
+        analysisManager->SetH1(kFirstH1 + layer, fNBins, 0., fEMax);
+        analysisManager->SetH1Activation(kFirstH1 + layer, fEnabled);
+    }
+    analysisManager->SetNtupleActivation(kTracksNtuple, fEnabled && fWriteTracks);
+
+    if (!fLocal) fLocal = new Local();
+    // volumes may have been rebuilt since the last run
+    fLocal->layers.clear();
+    fLocal->particle = (fParticleName == "all") ? nullptr
+                     : G4ParticleTable::GetParticleTable()->FindParticle(fParticleName);
+    fLocal->event.assign(kNLayers * fNBins, 0.);
+    fLocal->touched.clear();
+}
+
+G4int FluxTally::GetLayer(Local& local, const G4VPhysicalVolume* volume) const
+{
+    auto it = local.layers.find(volume);
+    if (it != local.layers.end()) return it->second;
+
+    G4int layer = -1;
+    for (G4int i = 0; volume && i < kNLayers; ++i) {
+        if (volume->GetName() == kLayerNames[i]) layer = i;
+    }
+    local.layers[volume] = layer;
+    return layer;
+}
+
+void FluxTally::StartTrack()
+{
+    auto& local = *fLocal;
+    for (auto& length : local.track) length = 0.;
+    local.tallied = false;
+}
+
+void FluxTally::AddStep(const G4Step* step)
+{
+    auto& local = *fLocal;
+    if (local.particle && step->GetTrack()->GetParticleDefinition() != local.particle) return;
+
+    const G4StepPoint* pre = step->GetPreStepPoint();
+    G4int layer = GetLayer(local, pre->GetPhysicalVolume());
+    if (layer < 0) return;
+
+    G4double length = step->GetStepLength();
+    local.track[layer] += length;
+    local.tallied = true;
+
+    G4int bin = static_cast<G4int>(pre->GetKineticEnergy() / fEMax * fNBins);
+    if (bin >= fNBins) return;
+    G4int index = layer * fNBins + bin;
+    if (local.event[index] == 0.) local.touched.push_back(index);
+    local.event[index] += pre->GetWeight() * length;
+}
+
+void FluxTally::EndTrack(const G4Track* track)
+{
+    auto& local = *fLocal;
+    if (!fWriteTracks || !local.tallied) return;
+
+    // replaces the old one-text-line-per-track dumps (gammas/*.txt)
+    G4int eventID = G4EventManager::GetEventManager()->GetConstCurrentEvent()->GetEventID();
+    fWriter->AddRow(kTracksNtuple, {static_cast<G4double>(eventID),
+                                    static_cast<G4double>(track->GetTrackID()),
+                                    static_cast<G4double>(track->GetParticleDefinition()->GetPDGEncoding()),
+                                    track->GetVertexKineticEnergy() / keV,
+                                    local.track[0] / mm, local.track[1] / mm, local.track[2] / mm,
+                                    local.track[3] / mm, local.track[4] / mm,
+                                    static_cast<G4double>(GetLayer(local, track->GetVolume()))});
+}
+
+void FluxTally::EndOfEvent()
+{
+    auto& local = *fLocal;
+    if (local.touched.empty()) return;
+
+    auto analysisManager = G4AnalysisManager::Instance();
+    G4double binWidth = fEMax / fNBins;
+    for (G4int index : local.touched) {
+        G4int layer = index / fNBins;
+        G4int bin = index % fNBins;
+        analysisManager->FillH1(kFirstH1 + layer, (bin + 0.5) * binWidth, local.event[index] / mm);
+        local.event[index] = 0.;
+    }
+    local.touched.clear();
+}
+
+void FluxTally::EndOfRun(G4int nEvents) const
+{
+    if (!fEnabled || nEvents <= 0) return;
+
+    auto analysisManager = G4AnalysisManager::Instance();
+    G4cout << "[Flux] " << (fParticleName == "all" ? G4String("all particles") : fParticleName)
+           << ", track length per event and fluence (track length / volume) per event:" << G4endl;
+    for (G4int layer = 0; layer < kNLayers; ++layer) {
+        auto h1 = analysisManager->GetH1(kFirstH1 + layer);
+        if (!h1) continue;
+        G4double length = h1->sum_bin_heights() / nEvents; // mm
+        G4double volume = GetLayerVolume(layer);
+        G4cout << "[Flux]   " << kLayerNames[layer] << ": " << length << " mm, "
+               << (volume > 0. ? length * mm / volume * cm2 : 0.) << " /cm2" << G4endl;
+    }
+}
@@ -1,8 +1,30 @@
 #include "generator.hh"
 #include "detectorShielding.hh"
+#include "sourceConfig.hh"
+#include "decayChain.hh"
+#include "sourceModel.hh"
+#include "leadTransport.hh"
+#include "G4IonTable.hh"
+#include "G4ParticleTable.hh"
 
-MyPrimaryGenerator::MyPrimaryGenerator(const detectorShielding* det)
-    : fDetector(det)
+#include <chrono>
+
+std::chrono::steady_clock::time_point MyPrimaryGenerator::fProcessStart = std::chrono::steady_clock::now();
+std::atomic<G4bool> MyPrimaryGenerator::fFirstEventSeen{false};
+
+MyPrimaryGenerator::MyPrimaryGenerator(const detectorShielding* det, const SourceConfig* source,
+                                       const DecayChain* chain, PhaseSpace* phaseSpace,
+                                       const SourceModel* model, LeadTransport* transport)
+    : fDetector(det),
+      fSource(source),
+      fChain(chain),
+      fPhaseSpace(phaseSpace),
+      fModel(model),
+      fTransport(transport),
+      fChainVersion(-1),
+      fModelVersion(-1),
+      fNVertices(0),
+      fVertexTime(0.)
 {
     fParticleSource = new G4GeneralParticleSource();
 }
@@ -12,6 +34,73 @@ MyPrimaryGenerator::~MyPrimaryGenerator()
     delete fParticleSource;
 }
 
+void MyPrimaryGenerator::ResetVertexStatistics()
+{
+    fNVertices = 0;
+    fVertexTime = 0.;
+}
+
+void MyPrimaryGenerator::UpdateChainIons()
+{
+    // ions can only be created once the physics is built, so not in the ctor
+    fChainIons.clear();
+    auto ionTable = G4IonTable::GetIonTable();
+    for (const auto& member : fChain->GetMembers()) {
+        fChainIons.push_back(ionTable->GetIon(member.Z, member.A, member.excitation));
+    }
+    fChainVersion = fChain->GetVersion();
+}
+
+void MyPrimaryGenerator::GenerateFromPhaseSpace(G4Event* anEvent)
+{
+    // one vertex per particle that crossed the boundary in the source event
+    fPhaseSpace->NextEvent(fReplayed);
+    auto particleTable = G4ParticleTable::GetParticleTable();
+    for (const auto& replayed : fReplayed) {
+        G4ParticleDefinition* definition = particleTable->FindParticle(replayed.pdg);
+        if (!definition && replayed.pdg > 1000000000) {
+            definition = G4IonTable::GetIonTable()->GetIon(replayed.pdg);
+        }
+        if (!definition) continue;
+
+        auto vertex = new G4PrimaryVertex(G4ThreeVector(replayed.x, replayed.y, replayed.z) * mm,
+                                          replayed.time * ns);
+        auto particle = new G4PrimaryParticle(definition);
+        particle->SetKineticEnergy(replayed.energy * keV);
+        particle->SetMomentumDirection(G4ThreeVector(replayed.u, replayed.v, replayed.w).unit());
+        particle->SetWeight(replayed.weight);
+        vertex->SetPrimary(particle);
+        anEvent->AddPrimaryVertex(vertex);
+    }
+}
+
+void MyPrimaryGenerator::GenerateFromModel(G4Event* anEvent)
+{
+    if (fModelVersion != fModel->GetVersion()) {
+        fModelIons.clear();
+        auto ionTable = G4IonTable::GetIonTable();
+        for (const auto& entry : fModel->GetEntries()) {
+            fModelIons.push_back(ionTable->GetIon(entry.Z, entry.A, 0.));
+        }
+        fModelVersion = fModel->GetVersion();
+    }
+
+    // one decay at rest, uniform in the layer of the sampled entry
+    G4int index = fModel->SampleEntry();
+    const auto& entry = fModel->GetEntries()[index];
+    ShellSampler& shell = fLayerShells[entry.layer];
+    G4double inner, outer;
+    fDetector->GetLayerBounds(entry.layer, inner, outer);
+    if (inner != shell.GetInner() || outer != shell.GetOuter()) shell.SetShell(inner, outer);
+
+    auto vertex = new G4PrimaryVertex(shell.Sample(), 0.);
+    auto particle = new G4PrimaryParticle(fModelIons[index]);
+    particle->SetKineticEnergy(0.);
+    vertex->SetPrimary(particle);
+    anEvent->AddPrimaryVertex(vertex);
+    anEvent->SetUserInformation(new SourceLabel(entry.layer, fModelIons[index]->GetPDGEncoding()));
+}
+
 void MyPrimaryGenerator::GeneratePrimaries(G4Event *anEvent)
 {
     // G4ParticleTable* particleTable = G4ParticleTable::GetParticleTable();
@@ -22,8 +111,69 @@ void MyPrimaryGenerator::GeneratePrimaries(G4Event *anEvent)
     // fParticleGun->SetParticleMomentumDirection(G4ThreeVector(0., 0., -1.));
     // fParticleGun->SetParticlePosition(G4ThreeVector(0., 0., 70*cm));
 
+    auto start = std::chrono::steady_clock::now();
+
+    // geometry, physics tables and thread start-up all come before this
+    if (!fFirstEventSeen.exchange(true)) {
+        G4cout << "[Run] Time to first event: "
+               << std::chrono::duration<G4double>(start - fProcessStart).count() << " s" << G4endl;
+    }
+
+    if (fTransport->IsCalibrating()) {
+        // Pb2 calibration photons, see LeadTransport::Calibrate
+        fTransport->GenerateCalibration(anEvent);
+        fVertexTime += std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+        fNVertices += anEvent->GetNumberOfPrimaryVertex();
+        return;
+    }
+
+    if (fPhaseSpace->IsReplaying()) {
+        // stage 2: the outer shield was transported when the file was recorded
+        GenerateFromPhaseSpace(anEvent);
+        fVertexTime += std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+        fNVertices += anEvent->GetNumberOfPrimaryVertex();
+        return;
+    }
+
+    if (fModel->IsActive()) {
+        // the whole background model: GPS, chain and shell settings are not used
+        GenerateFromModel(anEvent);
+        fVertexTime += std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+        fNVertices += anEvent->GetNumberOfPrimaryVertex();
+        return;
+    }
+
     fParticleSource->GeneratePrimaryVertex(anEvent);
-    G4double N = fDetector->GetTotalDecays();    
+
+    if (fChain->IsActive()) {
+        // one chain member decays per event, in place of the GPS particle
+        if (fChainVersion != fChain->GetVersion()) UpdateChainIons();
+        for (G4int i = 0; i < anEvent->GetNumberOfPrimaryVertex(); ++i) {
+            auto vertex = anEvent->GetPrimaryVertex(i);
+            for (G4int j = 0; j < vertex->GetNumberOfParticle(); ++j) {
+                vertex->GetPrimary(j)->SetParticleDefinition(fChainIons[fChain->SampleMember()]);
+            }
+        }
+    }
+
+    if (fSource->GetMode() == SourceConfig::Mode::Shell) {
+        // GPS supplies particle, energy and direction; the position is
+        // replaced by an exact sample inside the chosen shell
+        G4double inner, outer;
+        fDetector->GetLayerBounds(fSource->GetLayer(), inner, outer);
+        if (inner != fShell.GetInner() || outer != fShell.GetOuter()) {
+            fShell.SetShell(inner, outer);
+        }
+        for (G4int i = 0; i < anEvent->GetNumberOfPrimaryVertex(); ++i) {
+            G4ThreeVector pos = fShell.Sample();
+            anEvent->GetPrimaryVertex(i)->SetPosition(pos.x(), pos.y(), pos.z());
+        }
+    }
+
+    fVertexTime += std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+    fNVertices += anEvent->GetNumberOfPrimaryVertex();
+
+    G4long N = fDetector->GetTotalDecays();
     
     if (anEvent->GetEventID() == 0)
     {
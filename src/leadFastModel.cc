@@ -0,0 +1,52 @@
+#include "leadFastModel.hh"
+#include "G4FastTrack.hh"
+#include "G4FastStep.hh"
+#include "G4DynamicParticle.hh"
+#include "G4Gamma.hh"
+#include "G4Track.hh"
+#include "G4VProcess.hh"
+
+#include <algorithm>
+
+LeadFastModel::LeadFastModel(G4Region* envelope, const LeadTransport* transport)
+    : G4VFastSimulationModel("LeadFastModel", envelope),
+      fTransport(transport),
+      fEntry()
+{}
+
+G4bool LeadFastModel::IsApplicable(const G4ParticleDefinition& particle)
+{
+    return &particle == G4Gamma::Definition();
+}
+
+G4bool LeadFastModel::ModelTrigger(const G4FastTrack& fastTrack)
+{
+    if (!fTransport->IsActive()) return false;
+
+    // photons emitted by the model itself start on the inner surface, inside Pb2
+    const G4Track* track = fastTrack.GetPrimaryTrack();
+    const G4VProcess* creator = track->GetCreatorProcess();
+    if (creator && creator->GetProcessType() == fParameterisation) return false;
+
+    return fTransport->FindCell(track->GetKineticEnergy(), track->GetPosition(), track->GetMomentumDirection(),
+                                track->GetGlobalTime(), fEntry);
+}
+
+void LeadFastModel::DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep)
+{
+    fTransport->Sample(fEntry, fEmitted);
+
+    // whatever does not leave through the inner surface stays in the lead
+    G4double emitted = 0.;
+    for (const auto& photon : fEmitted) emitted += photon.energy;
+    fastStep.ProposeTotalEnergyDeposited(std::max(0., fEntry.energy - emitted));
+
+    G4double weight = fastTrack.GetPrimaryTrack()->GetWeight();
+    fastStep.SetNumberOfSecondaryTracks(static_cast<G4int>(fEmitted.size()));
+    for (const auto& photon : fEmitted) {
+        G4DynamicParticle particle(G4Gamma::Definition(), photon.direction, photon.energy);
+        G4Track* secondary = fastStep.CreateSecondaryTrack(particle, photon.position, photon.time, false);
+        secondary->SetWeight(weight);
+    }
+    fastStep.KillPrimaryTrack();
+}
@@ -0,0 +1,590 @@
+#include "leadTransport.hh"
+#include "detectorShielding.hh"
+#include "responseCache.hh"
+#include "G4RunManager.hh"
+#include "G4Event.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4Gamma.hh"
+#include "G4Material.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+G4ThreadLocal LeadTransport::Local* LeadTransport::fLocal = nullptr;
+
+namespace {
+    struct Header {
+        char magic[8];
+        std::int32_t version;
+        std::int32_t nEnergies;
+        std::int32_t depthBins;
+        std::int32_t angleBins;
+        double inner;                 // mm
+        double thickness;             // mm
+        double density;               // g/cm3
+        std::int64_t historiesPerCell;
+        char physics[32];
+    };
+    const char kMagic[8] = "PB2TRAN";
+    const std::int32_t kVersion = 1;
+
+    // emitted photons start this far inside Pb2, on the inner surface
+    const G4double kSurface = 1.*um;
+    // a single grid energy only covers itself
+    const G4double kEnergyTolerance = 1.e-6;
+
+    G4bool SameGeometry(G4double a, G4double b) { return std::abs(a - b) < 1.e-6 * std::max(1., std::abs(b)); }
+}
+
+LeadTransport::LeadTransport(const detectorShielding* det)
+    : fDetector(det),
+      fModelAttached(false),
+      fEnabled(false),
+      fLoaded(false),
+      fCalibrating(false),
+      fFileName("tables/Pb2Transport.bin"),
+      fEnergies({60., 100., 150., 200., 300., 400., 500., 600., 800., 1000., 1250., 1500., 2000., 2615.}),
+      fDepthBins(15),
+      fAngleBins(10),
+      fPhotons(0),
+      fEmitted(0),
+      fMessenger(nullptr)
+{
+    fMessenger = new G4GenericMessenger(this, "/Shielding/fastPb2/", "Parameterised photon transport in Pb2");
+
+    fMessenger->DeclareMethod("enable", &LeadTransport::SetEnabled)
+        .SetGuidance("Replace photon transport in Pb2 by the calibration table (default false)")
+        .SetParameterName("enable", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("table", &LeadTransport::SetTableFile)
+        .SetGuidance("Calibration table file (default tables/Pb2Transport.bin)")
+        .SetParameterName("file", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("energies", &LeadTransport::SetEnergies)
+        .SetGuidance("Entry energies of the next calibration in keV, ascending")
+        .SetGuidance("(default 60 100 150 200 300 400 500 600 800 1000 1250 1500 2000 2615)")
+        .SetParameterName("keV", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("depthBins", &LeadTransport::SetDepthBins)
+        .SetGuidance("Depth bins across the layer in the next calibration (default 15)")
+        .SetParameterName("bins", false)
+        .SetRange("bins>0")
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("angleBins", &LeadTransport::SetAngleBins)
+        .SetGuidance("Bins in the cosine to the inward normal in the next calibration (default 10)")
+        .SetParameterName("bins", false)
+        .SetRange("bins>0")
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("calibrate", &LeadTransport::Calibrate)
+        .SetGuidance("Full-transport calibration run with this many photons per (energy, depth)")
+        .SetGuidance("cell, written to the table file. A table of the same geometry, physics")
+        .SetGuidance("and grid with at least as many photons is loaded instead.")
+        .SetParameterName("histories", false)
+        .SetRange("histories>0")
+        .SetToBeBroadcasted(false);
+}
+
+LeadTransport::~LeadTransport()
+{
+    delete fMessenger;
+}
+
+LeadTransport::Local& LeadTransport::GetLocal()
+{
+    if (!fLocal) fLocal = new Local();
+    return *fLocal;
+}
+
+void LeadTransport::SetEnabled(G4bool enable)
+{
+    if (enable && !fModelAttached) {
+        G4Exception("LeadTransport::SetEnabled", "FastPb2NoModel", JustWarning,
+                    "The Pb2 fast-simulation model is not attached, photons are transported in full. "
+                    "Start sim with --fast-pb2.");
+        return;
+    }
+    fEnabled = enable;
+    G4cout << "[FastPb2] Parameterised Pb2 photon transport " << (enable ? "enabled" : "disabled") << G4endl;
+}
+
+void LeadTransport::SetEnergies(const G4String& input)
+{
+    std::istringstream is(input);
+    std::vector<G4double> energies;
+    G4double energy;
+    G4bool ascending = true;
+    while (is >> energy) {
+        if (energy <= 0. || (!energies.empty() && energy <= energies.back())) ascending = false;
+        energies.push_back(energy);
+    }
+    if (energies.empty() || !ascending || !is.eof()) {
+        G4Exception("LeadTransport::SetEnergies", "BadEnergies", JustWarning,
+                    "Usage: /Shielding/fastPb2/energies <keV, positive and ascending...>");
+        return;
+    }
+    fEnergies = energies;
+}
+
+void LeadTransport::SetDepthBins(G4int bins)
+{
+    fDepthBins = bins;
+}
+
+void LeadTransport::SetAngleBins(G4int bins)
+{
+    fAngleBins = bins;
+}
+
+G4bool LeadTransport::GetGeometry(Table& table) const
+{
+    const G4Material* material = fDetector->GetLayerMaterial(3);
+    if (!fDetector->GetWorldVolume() || !material) return false;
+    G4double inner, outer;
+    fDetector->GetLayerBounds(3, inner, outer);
+    table.inner = inner;
+    table.thickness = outer - inner;
+    table.density = material->GetDensity() / (g/cm3);
+    return true;
+}
+
+// ------------------------------------------------------------
+// Calibration
+// ------------------------------------------------------------
+void LeadTransport::Calibrate(G4int histories)
+{
+    Table table;
+    if (!GetGeometry(table)) {
+        G4Exception("LeadTransport::Calibrate", "NoGeometry", JustWarning,
+                    "Build the geometry (/run/initialize) before calibrating.");
+        return;
+    }
+    table.energies = fEnergies;
+    table.depthBins = fDepthBins;
+    table.angleBins = fAngleBins;
+
+    // a stored table of this geometry and grid is as good as a new one
+    Table stored;
+    if (Read(stored) && stored.energies == table.energies && stored.depthBins == table.depthBins
+        && stored.angleBins == table.angleBins && SameGeometry(stored.inner, table.inner)
+        && SameGeometry(stored.thickness, table.thickness) && SameGeometry(stored.density, table.density)
+        && stored.historiesPerCell >= histories) {
+        fTable = std::move(stored);
+        fLoaded = true;
+        G4cout << "[FastPb2] " << fFileName << " already holds " << fTable.historiesPerCell
+               << " photons per cell for this geometry, calibration skipped" << G4endl;
+        return;
+    }
+
+    G4long events = static_cast<G4long>(histories) * table.energies.size() * table.depthBins;
+    if (events > INT_MAX) {
+        G4Exception("LeadTransport::Calibrate", "TooManyEvents", JustWarning,
+                    "Calibration needs more than 2^31 events, use fewer histories.");
+        return;
+    }
+    table.historiesPerCell = histories;
+    table.cells.assign(table.energies.size() * table.depthBins * table.angleBins, Cell());
+    fTable = std::move(table);
+    fLoaded = false;
+
+    G4cout << "[FastPb2] Calibration: " << fTable.energies.size() << " energies x " << fTable.depthBins
+           << " depths x " << histories << " photons = " << events << " events, full transport" << G4endl;
+    fCalibrating = true;
+    G4RunManager::GetRunManager()->BeamOn(static_cast<G4int>(events));
+    fCalibrating = false;
+
+    fLoaded = true;
+    Write();
+    PrintCalibration();
+}
+
+void LeadTransport::GenerateCalibration(G4Event* event)
+{
+    Local& local = GetLocal();
+    if (local.cells.size() != fTable.cells.size()) local.cells.assign(fTable.cells.size(), Cell());
+
+    // (energy, depth) cells in turn, uniform depth within the cell and
+    // isotropic direction
+    const G4int depthBins = fTable.depthBins;
+    G4int cell = event->GetEventID() % (static_cast<G4int>(fTable.energies.size()) * depthBins);
+    G4int energyBin = cell / depthBins;
+    G4int depthBin = cell % depthBins;
+    G4double depth = (depthBin + G4UniformRand()) * fTable.thickness / depthBins;
+    G4double cosine = 2. * G4UniformRand() - 1.;
+    G4double phi = twopi * G4UniformRand();
+    G4double sine = std::sqrt(std::max(0., 1. - cosine * cosine));
+    G4int angleBin = std::min(fTable.angleBins - 1, static_cast<G4int>(0.5 * (cosine + 1.) * fTable.angleBins));
+
+    // centre of the +z slab, whose inward normal is -z
+    local.active = true;
+    local.cell = (energyBin * depthBins + depthBin) * fTable.angleBins + angleBin;
+    local.energy = fTable.energies[energyBin] * keV;
+    local.phi = phi;
+    local.direction = G4ThreeVector(sine * std::cos(phi), sine * std::sin(phi), -cosine);
+    local.event.clear();
+
+    auto vertex = new G4PrimaryVertex(G4ThreeVector(0., 0., fTable.inner + depth), 0.);
+    auto particle = new G4PrimaryParticle(G4Gamma::Definition());
+    particle->SetKineticEnergy(local.energy);
+    particle->SetMomentumDirection(local.direction);
+    vertex->SetPrimary(particle);
+    event->AddPrimaryVertex(vertex);
+}
+
+void LeadTransport::AddStep(const G4Step* step)
+{
+    if (!fLocal || !fLocal->active) return;
+    Local& local = *fLocal;
+
+    G4StepPoint* post = step->GetPostStepPoint();
+    if (post->GetStepStatus() != fGeomBoundary) return;
+    G4VPhysicalVolume* preVolume = step->GetPreStepPoint()->GetPhysicalVolume();
+    if (!preVolume || preVolume->GetName() != "Pb2") return;
+    // importance sub-slabs of Pb2 share its name
+    G4VPhysicalVolume* postVolume = post->GetPhysicalVolume();
+    if (postVolume && postVolume->GetName() == "Pb2") return;
+
+    // everything leaving the layer ends its history there, inwards or out
+    G4Track* track = step->GetTrack();
+    track->SetTrackStatus(fStopAndKill);
+    const G4ThreeVector& position = post->GetPosition();
+    G4double extent = std::max({std::abs(position.x()), std::abs(position.y()), std::abs(position.z())});
+    if (extent > fTable.inner + kSurface || track->GetParticleDefinition() != G4Gamma::Definition()) return;
+
+    // frame of the history: inward normal, entry azimuth and its normal
+    const G4ThreeVector normal(0., 0., -1.);
+    const G4ThreeVector along(std::cos(local.phi), std::sin(local.phi), 0.);
+    const G4ThreeVector across = normal.cross(along);
+
+    G4double energy = post->GetKineticEnergy();
+    const G4ThreeVector& direction = post->GetMomentumDirection();
+    Photon photon;
+    if (track->GetTrackID() != 1) {
+        photon.type = kSecondary;
+        photon.energy = energy / keV;
+    } else {
+        G4bool uncollided = std::abs(energy - local.energy) <= 1.e-9 * local.energy
+                            && direction.dot(local.direction) > 1. - 1.e-12;
+        photon.type = uncollided ? kUncollided : kScattered;
+        photon.energy = energy / local.energy;
+    }
+    photon.cosine = direction.dot(normal);
+    photon.phi = std::atan2(direction.dot(across), direction.dot(along));
+    G4ThreeVector displacement = position - G4ThreeVector(0., 0., fTable.inner);
+    photon.along = displacement.dot(along) / mm;
+    photon.across = displacement.dot(across) / mm;
+    photon.time = post->GetGlobalTime() / ns;
+    local.event.push_back(photon);
+}
+
+void LeadTransport::EndOfEvent()
+{
+    if (!fLocal || !fLocal->active) return;
+    Local& local = *fLocal;
+    local.active = false;
+
+    Cell& cell = local.cells[local.cell];
+    ++cell.histories;
+    if (local.event.empty()) return;
+    cell.photons.insert(cell.photons.end(), local.event.begin(), local.event.end());
+    cell.ends.push_back(static_cast<std::uint32_t>(cell.photons.size()));
+}
+
+// ------------------------------------------------------------
+// Parameterised transport
+// ------------------------------------------------------------
+G4bool LeadTransport::FindCell(G4double energy, const G4ThreeVector& position, const G4ThreeVector& direction,
+                               G4double time, Entry& entry) const
+{
+    const auto& grid = fTable.energies;
+    G4double e = energy / keV;
+    if (e < grid.front() * (1. - kEnergyTolerance) || e > grid.back() * (1. + kEnergyTolerance)) return false;
+
+    // between grid energies one neighbour is drawn, linearly in log(E)
+    G4int energyBin = 0;
+    auto upper = std::upper_bound(grid.begin(), grid.end(), e);
+    if (upper == grid.end()) {
+        energyBin = static_cast<G4int>(grid.size()) - 1;
+    } else if (upper != grid.begin()) {
+        G4int high = static_cast<G4int>(upper - grid.begin());
+        G4double fraction = std::log(e / grid[high - 1]) / std::log(grid[high] / grid[high - 1]);
+        energyBin = G4UniformRand() < fraction ? high : high - 1;
+    }
+
+    // depth and normal towards the nearest point of the inner cube
+    const G4double inner = fTable.inner;
+    G4ThreeVector nearest(std::clamp(position.x(), -inner, inner), std::clamp(position.y(), -inner, inner),
+                          std::clamp(position.z(), -inner, inner));
+    G4ThreeVector toInner = nearest - position;
+    G4double depth = toInner.mag();
+    G4ThreeVector normal;
+    if (depth > kSurface) {
+        normal = toInner / depth;
+    } else {
+        G4int axis = 0;
+        for (G4int k = 1; k < 3; ++k) {
+            if (std::abs(position[k]) > std::abs(position[axis])) axis = k;
+        }
+        normal[axis] = position[axis] > 0. ? -1. : 1.;
+        depth = 0.;
+    }
+    G4double cosine = direction.dot(normal);
+
+    const G4int depthBins = fTable.depthBins;
+    const G4int angleBins = fTable.angleBins;
+    G4int depthBin = std::min(depthBins - 1, static_cast<G4int>(depth / fTable.thickness * depthBins));
+    G4int angleBin = std::clamp(static_cast<G4int>(0.5 * (cosine + 1.) * angleBins), 0, angleBins - 1);
+    G4int cell = (energyBin * depthBins + depthBin) * angleBins + angleBin;
+    if (fTable.cells[cell].histories == 0) return false;
+
+    entry.cell = cell;
+    entry.energy = energy;
+    entry.position = position;
+    entry.direction = direction;
+    entry.time = time;
+    entry.depth = depth;
+    entry.normal = normal;
+    entry.cosine = cosine;
+    return true;
+}
+
+void LeadTransport::Sample(const Entry& entry, std::vector<Emitted>& emitted) const
+{
+    emitted.clear();
+    Local& local = GetLocal();
+    ++local.photons;
+
+    // one history of the cell; those past ends did not reach the surface
+    const Cell& cell = fTable.cells[entry.cell];
+    G4double u = G4UniformRand() * cell.histories;
+    if (u >= cell.ends.size()) return;
+    std::size_t history = static_cast<std::size_t>(u);
+    std::uint32_t begin = history ? cell.ends[history - 1] : 0;
+    std::uint32_t end = cell.ends[history];
+
+    // the calibration frame turned onto the entry point
+    const G4ThreeVector& normal = entry.normal;
+    G4ThreeVector along = entry.direction - entry.cosine * normal;
+    along = along.mag2() > 1.e-12 ? along.unit() : normal.orthogonal().unit();
+    const G4ThreeVector across = normal.cross(along);
+    const G4ThreeVector base = entry.position + entry.depth * normal;
+    const G4double inner = fTable.inner;
+
+    for (std::uint32_t i = begin; i < end; ++i) {
+        const Photon& photon = cell.photons[i];
+        Emitted out;
+        if (photon.type == kUncollided && entry.cosine > 1.e-3) {
+            // exact straight path of this photon
+            G4double path = entry.depth / entry.cosine;
+            out.energy = entry.energy;
+            out.direction = entry.direction;
+            out.position = entry.position + path * entry.direction;
+            out.time = entry.time + path / c_light;
+        } else {
+            out.energy = photon.type == kSecondary ? std::min<G4double>(photon.energy * keV, entry.energy)
+                                                   : photon.energy * entry.energy;
+            G4double sine = std::sqrt(std::max(0., 1. - photon.cosine * photon.cosine));
+            out.direction = (photon.cosine * normal
+                             + sine * (std::cos(photon.phi) * along + std::sin(photon.phi) * across)).unit();
+            out.position = base + photon.along * mm * along + photon.across * mm * across;
+            out.time = entry.time + photon.time * ns;
+        }
+
+        // onto the inner surface, on the Pb2 side
+        G4ThreeVector& q = out.position;
+        for (G4int k = 0; k < 3; ++k) q[k] = std::clamp(q[k], -inner, inner);
+        G4int axis = 0;
+        for (G4int k = 1; k < 3; ++k) {
+            if (std::abs(q[k]) > std::abs(q[axis])) axis = k;
+        }
+        q[axis] = (q[axis] < 0. ? -1. : 1.) * (inner + kSurface);
+        emitted.push_back(out);
+    }
+    local.emitted += emitted.size();
+}
+
+// ------------------------------------------------------------
+// Run bookkeeping
+// ------------------------------------------------------------
+void LeadTransport::Flush()
+{
+    if (!fLocal) return;
+    Local& local = *fLocal;
+
+    G4AutoLock lock(&fMutex);
+    fPhotons += local.photons;
+    fEmitted += local.emitted;
+    local.photons = local.emitted = 0;
+
+    if (fCalibrating && local.cells.size() == fTable.cells.size()) {
+        for (std::size_t c = 0; c < fTable.cells.size(); ++c) {
+            Cell& to = fTable.cells[c];
+            const Cell& from = local.cells[c];
+            std::uint32_t offset = static_cast<std::uint32_t>(to.photons.size());
+            to.histories += from.histories;
+            for (auto end : from.ends) to.ends.push_back(end + offset);
+            to.photons.insert(to.photons.end(), from.photons.begin(), from.photons.end());
+        }
+    }
+    local.cells.clear();
+    local.active = false;
+}
+
+void LeadTransport::BeginOfRun()
+{
+    {
+        G4AutoLock lock(&fMutex);
+        fPhotons = fEmitted = 0;
+    }
+    if (!fEnabled || fCalibrating) return;
+
+    // the table must describe the Pb2 of this run
+    Table current;
+    if (!GetGeometry(current)) return;
+    if (fLoaded && SameGeometry(fTable.inner, current.inner) && SameGeometry(fTable.thickness, current.thickness)
+        && SameGeometry(fTable.density, current.density)) return;
+
+    fLoaded = false;
+    Table stored;
+    if (!Read(stored) || !SameGeometry(stored.inner, current.inner)
+        || !SameGeometry(stored.thickness, current.thickness) || !SameGeometry(stored.density, current.density)) {
+        G4Exception("LeadTransport::BeginOfRun", "NoTable", JustWarning,
+                    ("No calibration of this Pb2 in " + fFileName
+                     + ", photons are transported in full. Use /Shielding/fastPb2/calibrate.").c_str());
+        return;
+    }
+    fTable = std::move(stored);
+    fLoaded = true;
+    G4cout << "[FastPb2] Table " << fFileName << " loaded: " << fTable.energies.size() << " energies, "
+           << fTable.depthBins << " depths, " << fTable.angleBins << " angles, "
+           << fTable.historiesPerCell << " photons per cell" << G4endl;
+}
+
+void LeadTransport::EndOfRun() const
+{
+    if (fCalibrating || fPhotons == 0) return;
+    G4cout << "[FastPb2] " << fPhotons << " photons in Pb2 parameterised, " << fEmitted
+           << " emitted at its inner surface (" << static_cast<G4double>(fEmitted) / fPhotons
+           << " per photon)" << G4endl;
+}
+
+void LeadTransport::PrintCalibration() const
+{
+    // chance to reach the inner surface per entry energy, over the layer and
+    // from its innermost depth bin (isotropic)
+    const G4int perEnergy = fTable.depthBins * fTable.angleBins;
+    G4cout << "[FastPb2] Calibration written to " << fFileName << G4endl;
+    for (std::size_t e = 0; e < fTable.energies.size(); ++e) {
+        G4double histories = 0., reached = 0., innerHistories = 0., innerReached = 0.;
+        for (G4int c = 0; c < perEnergy; ++c) {
+            const Cell& cell = fTable.cells[e * perEnergy + c];
+            histories += cell.histories;
+            reached += cell.ends.size();
+            if (c < fTable.angleBins) {
+                innerHistories += cell.histories;
+                innerReached += cell.ends.size();
+            }
+        }
+        G4cout << "[FastPb2]   " << std::setw(7) << fTable.energies[e] << " keV: reach the inner surface "
+               << (histories > 0. ? reached / histories : 0.) << " over the layer, "
+               << (innerHistories > 0. ? innerReached / innerHistories : 0.) << " from the first "
+               << fTable.thickness / fTable.depthBins / mm << " mm" << G4endl;
+    }
+}
+
+// ------------------------------------------------------------
+// Table file
+// ------------------------------------------------------------
+G4bool LeadTransport::Read(Table& table) const
+{
+    std::ifstream in(fFileName, std::ios::binary);
+    Header header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion) return false;
+    // tables of another physics list are built anew
+    header.physics[sizeof(header.physics) - 1] = '\0';
+    if (ResponseCache::GetPhysicsListName() != header.physics) return false;
+
+    table.energies.resize(header.nEnergies);
+    table.depthBins = header.depthBins;
+    table.angleBins = header.angleBins;
+    table.inner = header.inner * mm;
+    table.thickness = header.thickness * mm;
+    table.density = header.density;
+    table.historiesPerCell = header.historiesPerCell;
+    in.read(reinterpret_cast<char*>(table.energies.data()), header.nEnergies * sizeof(G4double));
+
+    table.cells.assign(static_cast<std::size_t>(header.nEnergies) * header.depthBins * header.angleBins, Cell());
+    for (auto& cell : table.cells) {
+        std::int64_t counts[3]; // histories, reaching histories, photons
+        if (!in.read(reinterpret_cast<char*>(counts), sizeof(counts))) return false;
+        cell.histories = counts[0];
+        cell.ends.resize(counts[1]);
+        cell.photons.resize(counts[2]);
+        in.read(reinterpret_cast<char*>(cell.ends.data()), counts[1] * sizeof(std::uint32_t));
+        in.read(reinterpret_cast<char*>(cell.photons.data()), counts[2] * sizeof(Photon));
+    }
+    return static_cast<G4bool>(in);
+}
+
+void LeadTransport::Write() const
+{
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.nEnergies = static_cast<std::int32_t>(fTable.energies.size());
+    header.depthBins = fTable.depthBins;
+    header.angleBins = fTable.angleBins;
+    header.inner = fTable.inner / mm;
+    header.thickness = fTable.thickness / mm;
+    header.density = fTable.density;
+    header.historiesPerCell = fTable.historiesPerCell;
+    std::strncpy(header.physics, ResponseCache::GetPhysicsListName().c_str(), sizeof(header.physics) - 1);
+
+    std::error_code ec;
+    auto directory = std::filesystem::path(fFileName.c_str()).parent_path();
+    if (!directory.empty()) std::filesystem::create_directories(directory, ec);
+
+    // written aside and renamed, so a kill never leaves half a table
+    G4String staging = fFileName + ".tmp";
+    {
+        std::ofstream out(staging, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(fTable.energies.data()), fTable.energies.size() * sizeof(G4double));
+        for (const auto& cell : fTable.cells) {
+            std::int64_t counts[3] = {cell.histories, static_cast<std::int64_t>(cell.ends.size()),
+                                      static_cast<std::int64_t>(cell.photons.size())};
+            out.write(reinterpret_cast<const char*>(counts), sizeof(counts));
+            out.write(reinterpret_cast<const char*>(cell.ends.data()), cell.ends.size() * sizeof(std::uint32_t));
+            out.write(reinterpret_cast<const char*>(cell.photons.data()), cell.photons.size() * sizeof(Photon));
+        }
+        if (!out) {
+            G4Exception("LeadTransport::Write", "CannotWrite", JustWarning,
+                        ("Cannot write the calibration table " + staging).c_str());
+            return;
+        }
+    }
+    std::filesystem::rename(staging.c_str(), fFileName.c_str(), ec);
+    if (ec) {
+        G4Exception("LeadTransport::Write", "CannotWrite", JustWarning,
+                    ("Cannot move the calibration table to " + fFileName).c_str());
+    }
+}
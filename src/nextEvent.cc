@@ -0,0 +1,457 @@
+#include "nextEvent.hh"
+#include "detectorShielding.hh"
+#include "leadTransport.hh"
+#include "G4AnalysisManager.hh"
+#include "G4EmCalculator.hh"
+#include "G4EmProcessSubType.hh"
+#include "G4NistManager.hh"
+#include "G4RunManager.hh"
+#include "G4Material.hh"
+#include "G4Gamma.hh"
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4VProcess.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4Threading.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <sstream>
+
+G4ThreadLocal NextEventEstimator::Local* NextEventEstimator::fLocal = nullptr;
+
+namespace {
+    // binned like EventEnergy
+    const G4int kNBins = 6000;
+    const G4double kEMax = 3.*MeV;
+
+    // attenuation tables: 40 points per decade from 1 keV to 10 MeV
+    const G4double kTableEMin = 1.*keV;
+    const G4int kPerDecade = 40;
+    const G4int kTableSize = 4 * kPerDecade + 1;
+
+    // Klein-Nishina cross section per electron over 2 pi r_e^2
+    G4double KleinNishina(G4double k)
+    {
+        if (k < 1.e-3) return 4. / 3. * (1. - 2. * k);
+        G4double l = std::log1p(2. * k);
+        return (1. + k) / (k * k) * (2. * (1. + k) / (1. + 2. * k) - l / k) + l / (2. * k)
+             - (1. + 3. * k) / ((1. + 2. * k) * (1. + 2. * k));
+    }
+}
+
+NextEventEstimator::NextEventEstimator(const detectorShielding* det, const LeadTransport* transport)
+    : fDetector(det),
+      fTransport(transport),
+      fEnabled(false),
+      fPoints(1),
+      fSums{0., 0., 0., 0.},
+      fSeconds(0.),
+      fMessenger(nullptr)
+{
+    fMessenger = new G4GenericMessenger(this, "/Shielding/nextEvent/", "Expected-value scoring in the HPGe");
+
+    fMessenger->DeclareMethod("enable", &NextEventEstimator::SetEnabled)
+        .SetGuidance("Score the expected first photon interactions in the HPGe at every photon")
+        .SetGuidance("interaction site (NEE_Interaction, NEE_Peak histograms; default false)")
+        .SetParameterName("enable", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("points", &NextEventEstimator::SetPoints)
+        .SetGuidance("Crystal points per Compton site (default 1)")
+        .SetParameterName("points", false)
+        .SetRange("points>0")
+        .SetToBeBroadcasted(false);
+
+    // /Shielding/nextEvent/peakFraction 609.3 0.35
+    fMessenger->DeclareMethod("peakFraction", &NextEventEstimator::AddPeakFraction)
+        .SetGuidance("<energy keV> <fraction>: full-energy peak counts per first interaction at")
+        .SetGuidance("this energy, interpolated in log(E) between entries. Without entries the")
+        .SetGuidance("photoabsorption share of the interactions in germanium is used (a lower bound).")
+        .SetParameterName("energy_fraction", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("clearPeakFractions", &NextEventEstimator::ClearPeakFractions)
+        .SetGuidance("Back to the photoabsorption share")
+        .SetToBeBroadcasted(false);
+}
+
+NextEventEstimator::~NextEventEstimator()
+{
+    delete fMessenger;
+}
+
+void NextEventEstimator::AddPeakFraction(const G4String& input)
+{
+    std::istringstream is(input);
+    G4double energy = -1., fraction = -1.;
+    is >> energy >> fraction;
+    if (energy <= 0. || fraction < 0. || fraction > 1.) {
+        G4Exception("NextEventEstimator::AddPeakFraction", "BadPeakFraction", JustWarning,
+                    "Usage: /Shielding/nextEvent/peakFraction <energy keV> <fraction in [0, 1]>");
+        return;
+    }
+    fPeakFractions.emplace_back(energy * keV, fraction);
+    std::sort(fPeakFractions.begin(), fPeakFractions.end());
+}
+
+void NextEventEstimator::ClearPeakFractions()
+{
+    fPeakFractions.clear();
+}
+
+// ------------------------------------------------------------
+// Run setup
+// ------------------------------------------------------------
+void NextEventEstimator::BeginOfRun()
+{
+    auto analysisManager = G4AnalysisManager::Instance();
+    analysisManager->SetH1Activation(kFirstH1, fEnabled);
+    analysisManager->SetH1Activation(kFirstH1 + 1, fEnabled);
+
+    if (!fLocal) fLocal = new Local();
+    Local& local = *fLocal;
+
+    // split tracks would score the same flight twice, and the Pb2
+    // calibration is no physics run
+    local.active = fEnabled && !fDetector->IsImportanceBiasing() && !fTransport->IsCalibrating();
+    if (G4Threading::IsMasterThread()) {
+        fSums[0] = fSums[1] = fSums[2] = fSums[3] = 0.;
+        fSeconds = 0.;
+        fStart = std::chrono::steady_clock::now();
+        if (fEnabled && fDetector->IsImportanceBiasing()) {
+            G4Exception("NextEventEstimator::BeginOfRun", "ImportanceBiasing", JustWarning,
+                        "The next-event estimator does not support importance biasing, it is off for this run.");
+        }
+    }
+    if (!local.active) return;
+
+    // the shells and the crystal of this run
+    for (G4int k = 0; k < 4; ++k) fDetector->GetLayerBounds(k, local.inner[k], local.outer[k]);
+    local.radius = fDetector->GetHPGeRadius();
+    local.halfLength = fDetector->GetHPGeHalfLength();
+    local.volume = fDetector->GetHPGeVolume();
+    // with the Pb2 model on, photons in Pb2 reach the inner surface through it
+    local.cutoff = fTransport->IsActive() ? local.inner[3] : DBL_MAX;
+
+    // attenuation of the physics list, on this thread
+    G4EmCalculator calculator;
+    const G4Material* materials[5] = {fDetector->GetLayerMaterial(0), fDetector->GetLayerMaterial(1),
+                                      fDetector->GetLayerMaterial(2), fDetector->GetLayerMaterial(3),
+                                      G4NistManager::Instance()->FindOrBuildMaterial("G4_Ge")};
+    for (auto& mu : local.table.mu) mu.assign(kTableSize, 0.);
+    local.table.peak.assign(kTableSize, 0.);
+    for (G4int i = 0; i < kTableSize; ++i) {
+        G4double energy = kTableEMin * std::pow(10., static_cast<G4double>(i) / kPerDecade);
+        for (G4int m = 0; m < 5; ++m) {
+            G4double length = calculator.ComputeGammaAttenuationLength(energy, materials[m]);
+            local.table.mu[m][i] = length > 0. ? 1. / length : 0.;
+        }
+        G4double photo = calculator.ComputeCrossSectionPerVolume(energy, G4Gamma::Definition(), "phot",
+                                                                 materials[4]);
+        local.table.peak[i] = local.table.mu[4][i] > 0. ? std::min(1., photo / local.table.mu[4][i]) : 0.;
+    }
+
+    local.interaction.assign(kNBins, 0.);
+    local.peak.assign(kNBins, 0.);
+    local.touched.clear();
+    local.eventScore = local.eventAnalog = 0.;
+    local.sums[0] = local.sums[1] = local.sums[2] = local.sums[3] = 0.;
+    local.seconds = 0.;
+}
+
+G4double NextEventEstimator::Mu(const Local& local, G4int material, G4double energy) const
+{
+    // linear in log(E) between the table points
+    G4double x = std::log10(energy / kTableEMin) * kPerDecade;
+    if (x <= 0.) return local.table.mu[material][0];
+    G4int i = static_cast<G4int>(x);
+    if (i >= kTableSize - 1) return local.table.mu[material][kTableSize - 1];
+    G4double f = x - i;
+    return (1. - f) * local.table.mu[material][i] + f * local.table.mu[material][i + 1];
+}
+
+G4double NextEventEstimator::PeakFraction(const Local& local, G4double energy) const
+{
+    if (fPeakFractions.empty()) {
+        G4double x = std::clamp(std::log10(energy / kTableEMin) * kPerDecade, 0., kTableSize - 1.);
+        G4int i = std::min(static_cast<G4int>(x), kTableSize - 2);
+        G4double f = x - i;
+        return (1. - f) * local.table.peak[i] + f * local.table.peak[i + 1];
+    }
+    if (energy <= fPeakFractions.front().first) return fPeakFractions.front().second;
+    if (energy >= fPeakFractions.back().first) return fPeakFractions.back().second;
+    std::size_t i = 1;
+    while (fPeakFractions[i].first < energy) ++i;
+    const auto& low = fPeakFractions[i - 1];
+    const auto& high = fPeakFractions[i];
+    G4double f = std::log(energy / low.first) / std::log(high.first / low.first);
+    return low.second + f * (high.second - low.second);
+}
+
+// ------------------------------------------------------------
+// Ray tracing
+// ------------------------------------------------------------
+G4double NextEventEstimator::OpticalDepth(const Local& local, const G4ThreeVector& p, const G4ThreeVector& q,
+                                          G4double energy) const
+{
+    // length of p -> q inside the cubes of the layer boundaries, from the
+    // cavity outwards; the path in a layer is the difference of its two cubes
+    const G4ThreeVector d = q - p;
+    const G4double length = d.mag();
+    const G4double bounds[5] = {local.inner[0], local.outer[0], local.outer[1], local.outer[2], local.outer[3]};
+    G4double inside[5];
+    for (G4int b = 0; b < 5; ++b) {
+        G4double tMin = 0., tMax = 1.;
+        for (G4int axis = 0; axis < 3 && tMin < tMax; ++axis) {
+            if (std::abs(d[axis]) < 1.e-12 * mm) {
+                if (std::abs(p[axis]) > bounds[b]) tMax = tMin;
+                continue;
+            }
+            G4double t1 = (-bounds[b] - p[axis]) / d[axis];
+            G4double t2 = (bounds[b] - p[axis]) / d[axis];
+            tMin = std::max(tMin, std::min(t1, t2));
+            tMax = std::min(tMax, std::max(t1, t2));
+        }
+        inside[b] = tMax > tMin ? (tMax - tMin) * length : 0.;
+    }
+
+    G4double depth = 0.;
+    for (G4int k = 0; k < 4; ++k) {
+        G4double path = inside[k + 1] - inside[k];
+        if (path > 0.) depth += Mu(local, k, energy) * path;
+    }
+    return depth;
+}
+
+G4double NextEventEstimator::ScoreFlight(const Local& local, const G4ThreeVector& p,
+                                         const G4ThreeVector& direction, G4double energy) const
+{
+    // the crystal is a cylinder along y: chord of the ray through it
+    const G4double radius = local.radius;
+    const G4double halfLength = local.halfLength;
+    G4double tIn = 0., tOut = DBL_MAX;
+
+    G4double a = direction.x() * direction.x() + direction.z() * direction.z();
+    G4double b = p.x() * direction.x() + p.z() * direction.z();
+    G4double c = p.x() * p.x() + p.z() * p.z() - radius * radius;
+    if (a < 1.e-12) {
+        if (c > 0.) return 0.;
+    } else {
+        G4double disc = b * b - a * c;
+        if (disc <= 0.) return 0.;
+        G4double root = std::sqrt(disc);
+        tIn = std::max(tIn, (-b - root) / a);
+        tOut = std::min(tOut, (-b + root) / a);
+    }
+    if (std::abs(direction.y()) < 1.e-12) {
+        if (std::abs(p.y()) > halfLength) return 0.;
+    } else {
+        G4double t1 = (-halfLength - p.y()) / direction.y();
+        G4double t2 = (halfLength - p.y()) / direction.y();
+        tIn = std::max(tIn, std::min(t1, t2));
+        tOut = std::min(tOut, std::max(t1, t2));
+    }
+    if (tOut <= tIn) return 0.;
+
+    // reaches the crystal unscattered and interacts in it
+    G4double depth = OpticalDepth(local, p, p + tIn * direction, energy);
+    return std::exp(-depth) * -std::expm1(-Mu(local, 4, energy) * (tOut - tIn));
+}
+
+void NextEventEstimator::ScoreCompton(Local& local, const G4ThreeVector& p, const G4ThreeVector& direction,
+                                      G4double energy, G4double weight) const
+{
+    const G4double k = energy / electron_mass_c2;
+    const G4double norm = 1. / (4. * pi * KleinNishina(k));
+    const G4double radius = local.radius;
+    const G4double halfLength = local.halfLength;
+
+    for (G4int n = 0; n < fPoints; ++n) {
+        // uniform in the crystal
+        G4double rho = radius * std::sqrt(G4UniformRand());
+        G4double phi = twopi * G4UniformRand();
+        G4ThreeVector point(rho * std::cos(phi), (2. * G4UniformRand() - 1.) * halfLength, rho * std::sin(phi));
+
+        G4ThreeVector v = point - p;
+        G4double r2 = v.mag2();
+        G4double r = std::sqrt(r2);
+        G4double cosine = direction.dot(v) / r;
+
+        // Klein-Nishina probability per solid angle towards the point
+        G4double ratio = 1. / (1. + k * (1. - cosine));
+        G4double scattered = ratio * energy;
+        G4double pdf = norm * ratio * ratio * (ratio + 1. / ratio - (1. - cosine * cosine));
+
+        // path in the crystal up to the point: p is outside it
+        G4double a = v.x() * v.x() + v.z() * v.z();
+        G4double b = p.x() * v.x() + p.z() * v.z();
+        G4double c = p.x() * p.x() + p.z() * p.z() - radius * radius;
+        G4double tRadial = (c > 0. && a > 0.) ? (-b - std::sqrt(std::max(b * b - a * c, 0.))) / a : 0.;
+        G4double tAxial = (std::abs(p.y()) > halfLength) ? (std::abs(p.y()) - halfLength) / std::abs(v.y()) : 0.;
+        G4double inCrystal = (1. - std::clamp(std::max(tRadial, tAxial), 0., 1.)) * r;
+
+        G4double muCrystal = Mu(local, 4, scattered);
+        G4double depth = OpticalDepth(local, p, point, scattered) + muCrystal * inCrystal;
+        G4double score = pdf * std::exp(-depth) * muCrystal * local.volume / (r2 * fPoints);
+        Score(local, scattered, weight * score);
+    }
+}
+
+void NextEventEstimator::Score(Local& local, G4double energy, G4double score) const
+{
+    if (score <= 0.) return;
+    local.eventScore += score;
+    G4int bin = static_cast<G4int>(energy / kEMax * kNBins);
+    if (bin >= kNBins) return;
+    if (local.interaction[bin] == 0.) local.touched.push_back(bin);
+    local.interaction[bin] += score;
+    local.peak[bin] += score * PeakFraction(local, energy);
+}
+
+// ------------------------------------------------------------
+// Event loop
+// ------------------------------------------------------------
+void NextEventEstimator::AddStep(const G4Step* step)
+{
+    if (!fLocal || !fLocal->active) return;
+    const G4Track* track = step->GetTrack();
+    if (track->GetParticleDefinition() != G4Gamma::Definition()) return;
+    Local& local = *fLocal;
+
+    const G4StepPoint* pre = step->GetPreStepPoint();
+    const G4StepPoint* post = step->GetPostStepPoint();
+    const G4VPhysicalVolume* volume = pre->GetPhysicalVolume();
+    G4bool inCrystal = volume && volume->GetName() == "HPGe";
+    const G4ThreeVector& site = post->GetPosition();
+    auto start = std::chrono::steady_clock::now();
+    G4bool scored = false;
+
+    // the flight from the start of the photon, in its direction
+    if (track->GetCurrentStepNumber() == 1) {
+        local.interacted = false;
+        const G4ThreeVector& origin = pre->GetPosition();
+        G4double extent = std::max({std::abs(origin.x()), std::abs(origin.y()), std::abs(origin.z())});
+        // photons of the Pb2 model start on its inner surface
+        const G4VProcess* creator = track->GetCreatorProcess();
+        G4bool fromModel = creator && creator->GetProcessType() == fParameterisation;
+        // photons born in the crystal, or in Pb2 and left to the model (or
+        // rejected by it), are not scored, and their analogue counts neither
+        local.scoredFlight = !inCrystal && (extent < local.cutoff || fromModel);
+        if (local.scoredFlight) {
+            G4double probability = ScoreFlight(local, origin, pre->GetMomentumDirection(), pre->GetKineticEnergy());
+            Score(local, pre->GetKineticEnergy(), pre->GetWeight() * probability);
+            scored = true;
+        }
+    }
+
+    const G4VProcess* process = post->GetProcessDefinedStep();
+    G4int type = process ? process->GetProcessSubType() : -1;
+    if (type == fRayleigh || type == fPhotoElectricEffect || type == fComptonScattering || type == fGammaConversion) {
+        if (inCrystal) {
+            // analogue count of the same quantity: the flight ending here
+            // was scored
+            if (!local.interacted && local.scoredFlight) local.eventAnalog += pre->GetWeight();
+            local.interacted = true;
+        } else if (!local.interacted) {
+            G4double extent = std::max({std::abs(site.x()), std::abs(site.y()), std::abs(site.z())});
+            // the flight from here is scored only inside the cutoff
+            local.scoredFlight = extent < local.cutoff;
+            if (local.scoredFlight && type == fComptonScattering) {
+                ScoreCompton(local, site, pre->GetMomentumDirection(), pre->GetKineticEnergy(), pre->GetWeight());
+                scored = true;
+            } else if (local.scoredFlight && type == fRayleigh) {
+                G4double probability = ScoreFlight(local, site, post->GetMomentumDirection(), post->GetKineticEnergy());
+                Score(local, post->GetKineticEnergy(), post->GetWeight() * probability);
+                scored = true;
+            }
+        }
+    }
+    if (scored) local.seconds += std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void NextEventEstimator::EndOfEvent()
+{
+    if (!fLocal || !fLocal->active) return;
+    Local& local = *fLocal;
+
+    auto analysisManager = G4AnalysisManager::Instance();
+    G4double binWidth = kEMax / kNBins;
+    for (G4int bin : local.touched) {
+        analysisManager->FillH1(kFirstH1, (bin + 0.5) * binWidth, local.interaction[bin]);
+        analysisManager->FillH1(kFirstH1 + 1, (bin + 0.5) * binWidth, local.peak[bin]);
+        local.interaction[bin] = local.peak[bin] = 0.;
+    }
+    local.touched.clear();
+
+    local.sums[0] += local.eventScore;
+    local.sums[1] += local.eventScore * local.eventScore;
+    local.sums[2] += local.eventAnalog;
+    local.sums[3] += local.eventAnalog * local.eventAnalog;
+    local.eventScore = local.eventAnalog = 0.;
+}
+
+void NextEventEstimator::Flush()
+{
+    if (!fLocal || !fLocal->active) return;
+    Local& local = *fLocal;
+
+    G4AutoLock lock(&fMutex);
+    for (G4int i = 0; i < 4; ++i) {
+        fSums[i] += local.sums[i];
+        local.sums[i] = 0.;
+    }
+    fSeconds += local.seconds;
+    local.seconds = 0.;
+}
+
+void NextEventEstimator::EndOfRun(G4int nEvents) const
+{
+    if (!fLocal || !fLocal->active || nEvents < 2) return;
+
+    // mean and error of the per-event first interactions
+    G4double n = nEvents;
+    auto statistics = [n](G4double sum, G4double sum2, G4double& mean, G4double& variance) {
+        mean = sum / n;
+        variance = std::max(0., (sum2 / n - mean * mean) * n / (n - 1.));
+    };
+    G4double meanScore, varScore, meanAnalog, varAnalog;
+    statistics(fSums[0], fSums[1], meanScore, varScore);
+    statistics(fSums[2], fSums[3], meanAnalog, varAnalog);
+    G4double errScore = std::sqrt(varScore / n);
+    G4double errAnalog = std::sqrt(varAnalog / n);
+
+    auto h1 = G4AnalysisManager::Instance()->GetH1(kFirstH1 + 1);
+    G4double peak = h1 ? h1->sum_bin_heights() / n : 0.;
+
+    G4cout << "[NextEvent] First photon interactions in the HPGe per event, " << nEvents << " events:" << G4endl;
+    G4cout << "[NextEvent]   analogue : " << meanAnalog << " +- " << errAnalog;
+    if (meanAnalog > 0.) G4cout << " (" << 100. * errAnalog / meanAnalog << " %)";
+    G4cout << G4endl;
+    G4cout << "[NextEvent]   estimator: " << meanScore << " +- " << errScore;
+    if (meanScore > 0.) G4cout << " (" << 100. * errScore / meanScore << " %)";
+    G4cout << G4endl;
+    G4double errDifference = std::sqrt(errScore * errScore + errAnalog * errAnalog);
+    if (errDifference > 0.) {
+        G4cout << "[NextEvent]   estimator - analogue: " << (meanScore - meanAnalog) / errDifference
+               << " standard errors" << G4endl;
+    }
+    G4cout << "[NextEvent]   estimated full-energy peak counts per event: " << peak << G4endl;
+
+    G4double wall = std::chrono::duration<G4double>(std::chrono::steady_clock::now() - fStart).count();
+    G4double threadTime = wall * G4RunManager::GetRunManager()->GetNumberOfThreads();
+    G4double share = threadTime > 0. ? std::min(1., fSeconds / threadTime) : 0.;
+    if (varAnalog > 0. && varScore > 0.) {
+        G4double reduction = varAnalog / varScore;
+        G4cout << "[NextEvent]   variance reduction " << reduction << ", estimator time "
+               << 100. * share << " % of the event loop, efficiency gain (FOM ratio) "
+               << reduction * (1. - share) << G4endl;
+    } else {
+        G4cout << "[NextEvent]   variance reduction not available (no analogue interactions or no scores)"
+               << G4endl;
+    }
+}
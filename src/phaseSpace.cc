@@ -0,0 +1,332 @@
+#include "phaseSpace.hh"
+#include "detectorShielding.hh"
+#include "G4Track.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#include <cstring>
+#include <cmath>
+
+G4ThreadLocal PhaseSpace::Local* PhaseSpace::fLocal = nullptr;
+
+namespace {
+    const char kMagic[8] = {'H', 'P', 'G', 'e', 'P', 'S', 'F', '1'};
+    const char* kLayerNames[4] = {"Cu1", "Cu2", "Pb1", "Pb2"};
+    // records a worker buffers before writing its whole events
+    const std::size_t kBufferRecords = 4096;
+}
+
+PhaseSpace::PhaseSpace(const detectorShielding* det)
+    : fDetector(det),
+      fMode(Mode::Off),
+      fLayer(1),
+      fLayerName("Cu2"),
+      fOuterName("Pb1"),
+      fFileName("phaseSpace.phsp"),
+      fRecycle(1),
+      fSymmetry(true),
+      fOpenMode(Mode::Off),
+      fHavePending(false),
+      fPasses(0),
+      fOpenCount(0),
+      fMessenger(nullptr)
+{
+    static_assert(sizeof(Particle) == 48, "phase-space record layout");
+    static_assert(sizeof(Header) == 48, "phase-space header layout");
+    std::memset(&fHeader, 0, sizeof(fHeader));
+
+    fMessenger = new G4GenericMessenger(this, "/Shielding/phaseSpace/", "Two-stage simulation through a phase-space file");
+
+    // /Shielding/phaseSpace/mode off|record|replay
+    fMessenger->DeclareMethod("mode", &PhaseSpace::SetMode)
+        .SetGuidance("record: store and kill particles entering /Shielding/phaseSpace/layer")
+        .SetGuidance("replay: generate events from the file instead of GPS")
+        .SetGuidance("off   : neither (default)")
+        .SetParameterName("mode", false)
+        .SetCandidates("off record replay")
+        .SetToBeBroadcasted(false);
+
+    // /Shielding/phaseSpace/layer Cu2 records the Pb1 -> Cu2 interface
+    fMessenger->DeclareMethod("layer", &PhaseSpace::SetLayer)
+        .SetGuidance("Layer whose outer surface is the recorded boundary (default Cu2)")
+        .SetParameterName("layer", false)
+        .SetCandidates("Cu1 Cu2 Pb1 Pb2")
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("file", &PhaseSpace::SetFileName)
+        .SetGuidance("Phase-space file written or read (default phaseSpace.phsp)")
+        .SetParameterName("fileName", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("recycle", &PhaseSpace::SetRecycle)
+        .SetGuidance("Replay every recorded event this many times (default 1)")
+        .SetParameterName("times", false)
+        .SetRange("times>0")
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("symmetry", &PhaseSpace::SetSymmetry)
+        .SetGuidance("Turn every replayed event by a random one of the 48 symmetries")
+        .SetGuidance("of the cubic shells (default true); needs a symmetric stage-1 source")
+        .SetParameterName("enable", false)
+        .SetToBeBroadcasted(false);
+}
+
+PhaseSpace::~PhaseSpace()
+{
+    Close();
+    delete fMessenger;
+}
+
+void PhaseSpace::SetMode(const G4String& mode)
+{
+    Close();
+    fMode = (mode == "record") ? Mode::Record : (mode == "replay") ? Mode::Replay : Mode::Off;
+    G4cout << "[PhaseSpace] Mode set to " << mode << G4endl;
+}
+
+void PhaseSpace::SetLayer(const G4String& layer)
+{
+    G4int index = fDetector->GetLayerIndex(layer);
+    if (index < 0) {
+        G4Exception("PhaseSpace::SetLayer", "BadLayer", JustWarning,
+                    "Unknown layer name, keeping previous phase-space boundary.");
+        return;
+    }
+    Close();
+    fLayer = index;
+    fLayerName = kLayerNames[index];
+    fOuterName = (index < 3) ? kLayerNames[index + 1] : "World";
+    G4cout << "[PhaseSpace] Boundary set to " << fOuterName << " -> " << fLayerName << G4endl;
+}
+
+void PhaseSpace::SetFileName(const G4String& fileName)
+{
+    Close();
+    fFileName = fileName;
+}
+
+void PhaseSpace::SetRecycle(G4int times)
+{
+    fRecycle = times;
+}
+
+G4double PhaseSpace::GetDecaysPerEvent() const
+{
+    // recycling repeats events but does not change what one stands for
+    if (fMode != Mode::Replay || fOpenMode != Mode::Replay || fHeader.recordedEvents <= 0) return 1.;
+    return static_cast<G4double>(fHeader.sourceEvents) / fHeader.recordedEvents;
+}
+
+void PhaseSpace::Close()
+{
+    G4AutoLock lock(&fMutex);
+    if (fFile.is_open()) {
+        if (fOpenMode == Mode::Record) WriteHeader();
+        fFile.close();
+    }
+    fOpenName = "";
+    fOpenMode = Mode::Off;
+    fHavePending = false;
+    fPasses = 0;
+}
+
+void PhaseSpace::WriteHeader()
+{
+    fFile.seekp(0);
+    fFile.write(reinterpret_cast<const char*>(&fHeader), sizeof(fHeader));
+    fFile.seekp(0, std::ios::end);
+    fFile.flush();
+}
+
+void PhaseSpace::BeginOfRun()
+{
+    if (fMode == Mode::Off) return;
+    // successive runs append to, or continue reading, the open file
+    if (fFile.is_open() && fOpenName == fFileName && fOpenMode == fMode) return;
+    Close();
+
+    G4AutoLock lock(&fMutex);
+    if (fMode == Mode::Record) {
+        G4double inner, outer;
+        fDetector->GetLayerBounds(fLayer, inner, outer);
+
+        std::memset(&fHeader, 0, sizeof(fHeader));
+        std::memcpy(fHeader.magic, kMagic, sizeof(kMagic));
+        fHeader.version = 1;
+        fHeader.layer = fLayer;
+        fHeader.boundary = outer / mm;
+
+        fFile.open(fFileName, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+        if (!fFile) {
+            G4Exception("PhaseSpace::BeginOfRun", "CannotWrite", FatalException,
+                        ("Cannot create phase-space file " + fFileName).c_str());
+            return;
+        }
+        WriteHeader();
+        G4cout << "[PhaseSpace] Recording particles entering " << fLayerName << " (half-length "
+               << fHeader.boundary << " mm) to " << fFileName << G4endl;
+    } else {
+        fFile.open(fFileName, std::ios::binary | std::ios::in);
+        if (!fFile || !fFile.read(reinterpret_cast<char*>(&fHeader), sizeof(fHeader)) ||
+            std::memcmp(fHeader.magic, kMagic, sizeof(kMagic)) != 0 || fHeader.records <= 0 ||
+            fHeader.layer < 0 || fHeader.layer > 3) {
+            G4Exception("PhaseSpace::BeginOfRun", "BadFile", FatalException,
+                        ("No phase-space records in " + fFileName).c_str());
+            return;
+        }
+
+        // the replayed particles start on the recorded surface, which the
+        // inner-geometry changes must leave in place
+        G4double inner, outer;
+        fDetector->GetLayerBounds(fHeader.layer, inner, outer);
+        if (std::abs(outer / mm - fHeader.boundary) > 1.e-6) {
+            G4Exception("PhaseSpace::BeginOfRun", "BoundaryMoved", FatalException,
+                        ("Phase-space boundary of " + fFileName + " is not the outer surface of "
+                         + kLayerNames[fHeader.layer] + " in this geometry").c_str());
+            return;
+        }
+        G4cout << "[PhaseSpace] Replaying " << fHeader.recordedEvents << " events (" << fHeader.records
+               << " particles) from " << fHeader.sourceEvents << " stage-1 events, "
+               << static_cast<G4double>(fHeader.sourceEvents) / fHeader.recordedEvents
+               << " decays per replayed event, recycle " << fRecycle
+               << (fSymmetry ? ", cube symmetries" : "") << G4endl;
+    }
+    fOpenName = fFileName;
+    fOpenMode = fMode;
+    ++fOpenCount;
+}
+
+void PhaseSpace::EndOfRun(G4int nEvents)
+{
+    if (fOpenMode == Mode::Off) return;
+    Flush(); // sequential mode: the master is also the worker
+
+    G4AutoLock lock(&fMutex);
+    if (fOpenMode == Mode::Record) {
+        fHeader.sourceEvents += nEvents;
+        WriteHeader();
+        G4cout << "[PhaseSpace] " << fHeader.records << " particles from " << fHeader.recordedEvents
+               << " of " << fHeader.sourceEvents << " events in " << fOpenName << G4endl;
+    } else if (fPasses > 0) {
+        G4cout << "[PhaseSpace] " << fOpenName << " replayed " << fPasses + 1
+               << " times over, events are correlated" << G4endl;
+    }
+}
+
+void PhaseSpace::Record(const G4Track* track, G4int eventID)
+{
+    if (!fLocal) fLocal = new Local();
+    auto& local = *fLocal;
+
+    // only whole events are written, so the buffer is flushed between events
+    G4bool first = (eventID != local.lastEventID);
+    if (first && local.records.size() >= kBufferRecords) Flush();
+    local.lastEventID = eventID;
+
+    const G4ThreeVector& pos = track->GetPosition();
+    const G4ThreeVector& dir = track->GetMomentumDirection();
+    Particle record;
+    record.pdg = track->GetParticleDefinition()->GetPDGEncoding();
+    record.flags = first ? kFirstInEvent : 0;
+    record.energy = track->GetKineticEnergy() / keV;
+    record.x = pos.x() / mm;
+    record.y = pos.y() / mm;
+    record.z = pos.z() / mm;
+    record.u = dir.x();
+    record.v = dir.y();
+    record.w = dir.z();
+    record.weight = track->GetWeight();
+    record.time = track->GetGlobalTime() / ns;
+    local.records.push_back(record);
+}
+
+void PhaseSpace::Flush()
+{
+    if (!fLocal) return;
+    auto& local = *fLocal;
+    // event IDs restart with every run
+    local.lastEventID = -1;
+    if (local.records.empty()) return;
+
+    G4AutoLock lock(&fMutex);
+    if (fOpenMode == Mode::Record && fFile.is_open()) {
+        fFile.write(reinterpret_cast<const char*>(local.records.data()),
+                    local.records.size() * sizeof(Particle));
+        for (const auto& record : local.records) {
+            if (record.flags & kFirstInEvent) ++fHeader.recordedEvents;
+        }
+        fHeader.records += local.records.size();
+    }
+    local.records.clear();
+}
+
+G4bool PhaseSpace::ReadRecord(Particle& record)
+{
+    if (fFile.read(reinterpret_cast<char*>(&record), sizeof(Particle))) return true;
+
+    // out of events: start again from the first one
+    fFile.clear();
+    fFile.seekg(sizeof(Header));
+    if (++fPasses == 1) {
+        G4Exception("PhaseSpace::ReadRecord", "FileExhausted", JustWarning,
+                    "All recorded events used, replaying the phase-space file from the start.");
+    }
+    return static_cast<G4bool>(fFile.read(reinterpret_cast<char*>(&record), sizeof(Particle)));
+}
+
+void PhaseSpace::ReadEvent(std::vector<Particle>& event)
+{
+    event.clear();
+    if (!fHavePending && !ReadRecord(fPending)) return;
+    event.push_back(fPending);
+    fHavePending = false;
+
+    Particle record;
+    while (ReadRecord(record)) {
+        if (record.flags & kFirstInEvent) {
+            fPending = record;
+            fHavePending = true;
+            return;
+        }
+        event.push_back(record);
+    }
+}
+
+void PhaseSpace::NextEvent(std::vector<Particle>& particles)
+{
+    if (!fLocal) fLocal = new Local();
+    auto& local = *fLocal;
+
+    if (local.usesLeft <= 0 || local.openCount != fOpenCount) {
+        G4AutoLock lock(&fMutex);
+        ReadEvent(local.event);
+        local.usesLeft = fRecycle;
+        local.openCount = fOpenCount;
+    }
+    --local.usesLeft;
+
+    particles = local.event;
+    if (fSymmetry) {
+        // one symmetry per event keeps the angular correlations of its particles
+        G4int element = static_cast<G4int>(48 * G4UniformRand());
+        for (auto& particle : particles) ApplySymmetry(element, particle);
+    }
+}
+
+void PhaseSpace::ApplySymmetry(G4int element, Particle& record)
+{
+    // the 48 symmetries of the cube: 6 axis permutations times 8 reflections
+    static const G4int kPermutations[6][3] = {
+        {0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}
+    };
+    const G4int* permutation = kPermutations[element / 8];
+    const float pos[3] = {record.x, record.y, record.z};
+    const float dir[3] = {record.u, record.v, record.w};
+    float* newPos[3] = {&record.x, &record.y, &record.z};
+    float* newDir[3] = {&record.u, &record.v, &record.w};
+    for (G4int i = 0; i < 3; ++i) {
+        float sign = ((element >> i) & 1) ? -1.f : 1.f;
+        *newPos[i] = sign * pos[permutation[i]];
+        *newDir[i] = sign * dir[permutation[i]];
+    }
+}
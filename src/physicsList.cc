@@ -0,0 +1,21 @@
+#include "physicsList.hh"
+
+#include "G4EmLivermorePhysics.hh"
+#include "G4EmStandardPhysics_option4.hh"
+#include "G4DecayPhysics.hh"
+#include "G4RadioactiveDecayPhysics.hh"
+
+MyPhysicsList::MyPhysicsList(const G4String& em)
+{
+    if (em == "option4") {
+        RegisterPhysics(new G4EmStandardPhysics_option4());
+    } else {
+        RegisterPhysics(new G4EmLivermorePhysics());
+    }
+    // G4DecayPhysics also constructs the ions needed by radioactive decay
+    RegisterPhysics(new G4DecayPhysics());
+    RegisterPhysics(new G4RadioactiveDecayPhysics());
+}
+
+MyPhysicsList::~MyPhysicsList()
+{}
@@ -0,0 +1,162 @@
+#include "physicsTableCache.hh"
+#include "G4VUserPhysicsList.hh"
+#include "G4ProductionCutsTable.hh"
+#include "G4ProductionCuts.hh"
+#include "G4RegionStore.hh"
+#include "G4Region.hh"
+#include "G4Material.hh"
+#include "G4StateManager.hh"
+#include "G4Timer.hh"
+#include "G4Version.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+PhysicsTableCache::PhysicsTableCache(const G4String& directory, const G4String& physicsList)
+    : fDirectory(directory),
+      fPhysicsList(physicsList),
+      fPhysList(nullptr),
+      fBuilt(false)
+{}
+
+PhysicsTableCache::~PhysicsTableCache()
+{}
+
+G4String PhysicsTableCache::GetCutsText()
+{
+    // gamma, e-, e+ and proton cuts of every region with its own cuts
+    std::ostringstream text;
+    for (const auto region : *G4RegionStore::GetInstance()) {
+        auto cuts = region->GetProductionCuts();
+        if (!cuts) continue;
+        text << "region " << region->GetName();
+        for (G4int i = 0; i < 4; ++i) text << " " << cuts->GetProductionCut(i) / mm;
+        text << "\n";
+    }
+    return text.str();
+}
+
+G4String PhysicsTableCache::HashText(const G4String& text)
+{
+    // FNV-1a, stable across compilers and processes unlike std::hash
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    char digits[17];
+    std::snprintf(digits, sizeof(digits), "%016llx", static_cast<unsigned long long>(hash));
+    return digits;
+}
+
+G4String PhysicsTableCache::GetKeyText() const
+{
+    std::ostringstream key;
+    key << "geant4 " << G4Version << "\n"
+        << "physics " << fPhysicsList << "\n"
+        << "defaultCut " << fPhysList->GetDefaultCutValue() / mm << "\n"
+        << GetCutsText();
+    for (const auto material : *G4Material::GetMaterialTable()) {
+        key << "material " << material->GetName() << " " << material->GetDensity() / (g/cm3) << "\n";
+    }
+    return key.str();
+}
+
+void PhysicsTableCache::Prepare(G4VUserPhysicsList* physList)
+{
+    fPhysList = physList;
+    G4cout << "[FastStart] Physics tables are looked up in " << fDirectory
+           << " at the first beamOn, with the cuts and geometry of the macro" << G4endl;
+}
+
+void PhysicsTableCache::SetKey()
+{
+    fKeyText = GetKeyText();
+    fEntry = fDirectory + "/" + fPhysicsList + "_" + HashText(fKeyText);
+}
+
+void PhysicsTableCache::Lookup()
+{
+    // may run more than once before the tables are built (a geometry
+    // re-initialisation also passes through Init); the last one counts
+    SetKey();
+    if (std::filesystem::exists((fEntry + "/key.txt").c_str())) {
+        fPhysList->SetPhysicsTableRetrieved(fEntry);
+        fRetrievedEntry = fEntry;
+    } else {
+        fPhysList->ResetPhysicsTableRetrieved();
+        fRetrievedEntry = "";
+    }
+}
+
+G4bool PhysicsTableCache::Notify(G4ApplicationState requestedState)
+{
+    if (!fPhysList) return true;
+
+    auto previous = G4StateManager::GetStateManager()->GetPreviousState();
+    if (requestedState == G4State_Init && previous == G4State_Idle && !fBuilt) {
+        // a beamOn about to update the couples and build the tables
+        Lookup();
+    } else if (requestedState == G4State_GeomClosed) {
+        // the tables now in memory belong to the cuts now in force
+        if (!fBuilt) {
+            if (fRetrievedEntry.empty()) {
+                G4cout << "[FastStart] No stored physics tables for this configuration, they are stored in "
+                       << fEntry << " at exit" << G4endl;
+            } else {
+                G4cout << "[FastStart] Physics tables retrieved from " << fRetrievedEntry << G4endl;
+                // a later change of cuts builds its tables as usual
+                fPhysList->ResetPhysicsTableRetrieved();
+            }
+        }
+        fBuilt = true;
+        SetKey();
+    }
+    return true;
+}
+
+void PhysicsTableCache::Store() const
+{
+    if (!fPhysList || !fBuilt) return;
+    // nothing to store before a first run built the tables, or when the
+    // last run used the retrieved ones as they are
+    auto cutsTable = G4ProductionCutsTable::GetProductionCutsTable();
+    if (cutsTable->GetTableSize() == 0 || fEntry == fRetrievedEntry) return;
+
+    G4Timer timer;
+    timer.Start();
+
+    // written aside and renamed, so concurrent jobs never read half an entry
+    G4String staging = fEntry + ".tmp" + std::to_string(getpid());
+    std::error_code ec;
+    std::filesystem::remove_all(staging.c_str(), ec);
+    std::filesystem::create_directories(staging.c_str(), ec);
+    if (ec || !fPhysList->StorePhysicsTable(staging)) {
+        G4Exception("PhysicsTableCache::Store", "CannotStore", JustWarning,
+                    ("Cannot store physics tables in " + staging).c_str());
+        std::filesystem::remove_all(staging.c_str(), ec);
+        return;
+    }
+    std::ofstream((staging + "/key.txt").c_str()) << fKeyText;
+
+    // a published entry is never replaced: another job may be retrieving it,
+    // and it holds the tables of the same key
+    if (std::filesystem::exists(fEntry.c_str())) {
+        std::filesystem::remove_all(staging.c_str(), ec);
+        return;
+    }
+    std::filesystem::rename(staging.c_str(), fEntry.c_str(), ec);
+    if (ec) {
+        // another job got there first
+        std::filesystem::remove_all(staging.c_str(), ec);
+        return;
+    }
+    timer.Stop();
+    G4cout << "[FastStart] Physics tables stored in " << fEntry << " (" << timer.GetRealElapsed()
+           << " s)" << G4endl;
+}
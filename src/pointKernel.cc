@@ -0,0 +1,393 @@
+#include "pointKernel.hh"
+#include "detectorShielding.hh"
+#include "G4Material.hh"
+#include "G4NistManager.hh"
+#include "G4Timer.hh"
+#include "G4UnitsTable.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+    const char* kLayerNames[4] = {"Cu1", "Cu2", "Pb1", "Pb2"};
+
+    // NIST XCOM mass attenuation coefficients (total, with coherent
+    // scattering), cm2/g; interpolated log-log, clamped outside the table
+    const G4int kNEnergies = 13;
+    const G4double kEnergy[kNEnergies] = {0.1, 0.15, 0.2, 0.3, 0.4, 0.5, 0.6, 0.8, 1.0, 1.25, 1.5, 2.0, 3.0}; // MeV
+    const G4double kMuCu[kNEnergies] = {0.4584, 0.2220, 0.1559, 0.1083, 0.09220, 0.08361, 0.07625,
+                                        0.06605, 0.05901, 0.05261, 0.04803, 0.04205, 0.03599};
+    const G4double kMuPb[kNEnergies] = {5.549, 2.014, 0.9985, 0.4031, 0.2323, 0.1614, 0.1248,
+                                        0.08870, 0.07102, 0.05876, 0.05222, 0.04606, 0.04234};
+    const G4double kMuGe[kNEnergies] = {0.5550, 0.2491, 0.1661, 0.1131, 0.09327, 0.08212, 0.07452,
+                                        0.06426, 0.05727, 0.05101, 0.04657, 0.04086, 0.03524};
+
+    // point-isotropic exposure build-up factors (Goldstein-Wilkins) at 1, 2,
+    // 4 and 7 mean free paths; iron stands in for copper
+    const G4double kBuildupEnergy[4] = {0.5, 1.0, 2.0, 3.0}; // MeV
+    const G4double kBuildupMfp[4] = {1., 2., 4., 7.};
+    const G4double kBuildupPb[4][4] = {{1.24, 1.42, 1.69, 2.00},
+                                       {1.37, 1.69, 2.26, 3.02},
+                                       {1.39, 1.76, 2.51, 3.66},
+                                       {1.34, 1.68, 2.43, 3.75}};
+    const G4double kBuildupFe[4][4] = {{1.98, 3.09, 5.98, 11.7},
+                                       {1.87, 2.89, 5.39, 10.2},
+                                       {1.76, 2.61, 4.55, 8.05},
+                                       {1.55, 2.26, 3.72, 6.30}};
+
+    // crystal nodes: Gauss-Legendre in radius and along the axis, uniform
+    // in azimuth
+    const G4int kRadialPoints = 4;
+    const G4int kAzimuthPoints = 8;
+    const G4int kAxialPoints = 4;
+
+    G4double MassAttenuation(const G4double* table, G4double energy)
+    {
+        G4double e = std::clamp(energy / MeV, kEnergy[0], kEnergy[kNEnergies - 1]);
+        G4int i = 0;
+        while (i < kNEnergies - 2 && e > kEnergy[i + 1]) ++i;
+        G4double f = std::log(e / kEnergy[i]) / std::log(kEnergy[i + 1] / kEnergy[i]);
+        return std::exp(std::log(table[i]) + f * std::log(table[i + 1] / table[i])) * cm2 / g;
+    }
+
+    // build-up factors at the tabulated depths for one energy, interpolated
+    // in log(energy)
+    void BuildupAtEnergy(const G4double table[4][4], G4double energy, G4double row[4])
+    {
+        G4double e = std::clamp(energy / MeV, kBuildupEnergy[0], kBuildupEnergy[3]);
+        G4int i = 0;
+        while (i < 2 && e > kBuildupEnergy[i + 1]) ++i;
+        G4double f = std::log(e / kBuildupEnergy[i]) / std::log(kBuildupEnergy[i + 1] / kBuildupEnergy[i]);
+        for (G4int j = 0; j < 4; ++j) row[j] = table[i][j] + f * (table[i + 1][j] - table[i][j]);
+    }
+
+    // B(0) = 1; linear between the tabulated depths and beyond the last
+    inline G4double Buildup(const G4double row[4], G4double mfp)
+    {
+        if (mfp <= kBuildupMfp[0]) return 1. + mfp * (row[0] - 1.);
+        G4int j = (mfp <= kBuildupMfp[2]) ? (mfp <= kBuildupMfp[1] ? 0 : 1) : 2;
+        return row[j] + (mfp - kBuildupMfp[j]) * (row[j + 1] - row[j]) / (kBuildupMfp[j + 1] - kBuildupMfp[j]);
+    }
+
+    // n-point Gauss-Legendre nodes and weights on [0, 1]
+    void GaussLegendre(G4int n, std::vector<G4double>& x, std::vector<G4double>& w)
+    {
+        x.resize(n);
+        w.resize(n);
+        for (G4int i = 0; i < n; ++i) {
+            G4double z = std::cos(pi * (i + 0.75) / (n + 0.5));
+            G4double dp = 1.;
+            for (G4int iter = 0; iter < 100; ++iter) {
+                G4double p0 = 1., p1 = 0.;
+                for (G4int j = 1; j <= n; ++j) {
+                    G4double p2 = p1;
+                    p1 = p0;
+                    p0 = ((2. * j - 1.) * z * p1 - (j - 1.) * p2) / j;
+                }
+                dp = n * (z * p0 - p1) / (z * z - 1.);
+                G4double dz = p0 / dp;
+                z -= dz;
+                if (std::abs(dz) < 1.e-14) break;
+            }
+            x[i] = 0.5 * (1. - z);
+            w[i] = 1. / ((1. - z * z) * dp * dp);
+        }
+    }
+}
+
+PointKernel::PointKernel(const detectorShielding* det)
+    : fDetector(det),
+      fDepthPoints(8),
+      fLateralPoints(12),
+      fBuildup(true),
+      fMessenger(nullptr)
+{
+    // Ra-226 chain lines of the gammas/ track studies: Pb-214 295 keV and
+    // Bi-214 609, 1120 and 1764 keV, per decay of the equilibrium chain
+    fLines = {{295.2 * keV, 0.184, 1.}, {609.3 * keV, 0.455, 1.},
+              {1120.3 * keV, 0.149, 1.}, {1764.5 * keV, 0.153, 1.}};
+
+    fMessenger = new G4GenericMessenger(this, "/Shielding/pointKernel/", "Analytic point-kernel rate estimate");
+
+    // /Shielding/pointKernel/line 609.3 0.455 0.4
+    fMessenger->DeclareMethod("line", &PointKernel::AddLine)
+        .SetGuidance("<energy keV> <yield per decay> [peak fraction]: add a gamma line. The peak")
+        .SetGuidance("fraction turns first interactions into full-energy peak counts (default 1,")
+        .SetGuidance("an upper bound). Defaults: 295.2, 609.3, 1120.3, 1764.5 keV; clearLines first.")
+        .SetParameterName("line", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("clearLines", &PointKernel::ClearLines)
+        .SetGuidance("Remove all gamma lines")
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("quadrature", &PointKernel::SetQuadrature)
+        .SetGuidance("<depth> <lateral>: Gauss-Legendre nodes per face slab across and along the")
+        .SetGuidance("layer (default 8 12)")
+        .SetParameterName("nodes", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("buildup", &PointKernel::SetBuildup)
+        .SetGuidance("Also print the rate including photons scattered in the shield (default true)")
+        .SetParameterName("enable", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("run", &PointKernel::Run)
+        .SetGuidance("Estimate the line rates for the current geometry and layer activities")
+        .SetToBeBroadcasted(false);
+}
+
+PointKernel::~PointKernel()
+{
+    delete fMessenger;
+}
+
+void PointKernel::AddLine(const G4String& input)
+{
+    std::istringstream is(input);
+    G4double energy = -1., yield = -1., peakFraction = 1.;
+    is >> energy >> yield;
+    if (!(is >> peakFraction)) peakFraction = 1.;
+    if (energy <= 0. || yield <= 0. || peakFraction <= 0. || peakFraction > 1.) {
+        G4Exception("PointKernel::AddLine", "BadLine", JustWarning,
+                    "Usage: /Shielding/pointKernel/line <energy keV> <yield> [peak fraction in (0, 1]]");
+        return;
+    }
+    if (energy * keV < kEnergy[0] * MeV || energy * keV > kEnergy[kNEnergies - 1] * MeV) {
+        G4Exception("PointKernel::AddLine", "OutsideTable", JustWarning,
+                    "Line outside the 100 keV - 3 MeV attenuation table, the nearest entry is used.");
+    }
+    fLines.push_back({energy * keV, yield, peakFraction});
+}
+
+void PointKernel::ClearLines()
+{
+    fLines.clear();
+}
+
+void PointKernel::SetQuadrature(const G4String& input)
+{
+    std::istringstream is(input);
+    G4int depth = 0, lateral = 0;
+    is >> depth >> lateral;
+    if (depth <= 0 || lateral <= 0) {
+        G4Exception("PointKernel::SetQuadrature", "BadQuadrature", JustWarning,
+                    "Usage: /Shielding/pointKernel/quadrature <depth> <lateral>");
+        return;
+    }
+    fDepthPoints = depth;
+    fLateralPoints = lateral;
+}
+
+void PointKernel::Integrate(G4int layer, const Line& line, const Crystal& crystal,
+                            G4double& uncollided, G4double& scattered) const
+{
+    // inner half-lengths of the source layer and of every layer inside it,
+    // and the linear attenuation coefficients along the way in
+    G4double bound[4], mu[4];
+    G4bool lead[4];
+    G4double inner = 0., outer = 0.;
+    for (G4int k = 0; k <= layer; ++k) {
+        fDetector->GetLayerBounds(k, inner, outer);
+        bound[k] = inner;
+        lead[k] = (k >= 2);
+        mu[k] = MassAttenuation(lead[k] ? kMuPb : kMuCu, line.energy)
+              * fDetector->GetLayerMaterial(k)->GetDensity();
+    }
+    G4double muGe = MassAttenuation(kMuGe, line.energy)
+                  * G4NistManager::Instance()->FindOrBuildMaterial("G4_Ge")->GetDensity();
+    G4double radius = fDetector->GetHPGeRadius();
+    G4double halfLength = fDetector->GetHPGeHalfLength();
+    G4double buildupPb[4], buildupCu[4];
+    BuildupAtEnergy(kBuildupPb, line.energy, buildupPb);
+    BuildupAtEnergy(kBuildupFe, line.energy, buildupCu);
+
+    // depth across the layer mapped so that exp(-mu depth) is uniform in the
+    // quadrature variable; the shield attenuation then varies slowly
+    std::vector<G4double> depthX, depthW, lateralX, lateralW;
+    GaussLegendre(fDepthPoints, depthX, depthW);
+    GaussLegendre(fLateralPoints, lateralX, lateralW);
+    G4double thickness = outer - inner;
+    G4double muSource = mu[layer];
+    G4double q = -std::expm1(-muSource * thickness);
+    std::vector<G4double> depth(fDepthPoints), depthWeight(fDepthPoints);
+    for (G4int i = 0; i < fDepthPoints; ++i) {
+        if (muSource * thickness < 1.e-6) {
+            depth[i] = inner + depthX[i] * thickness;
+            depthWeight[i] = depthW[i] * thickness;
+        } else {
+            depth[i] = inner - std::log1p(-depthX[i] * q) / muSource;
+            depthWeight[i] = depthW[i] * q / (muSource * (1. - depthX[i] * q));
+        }
+    }
+
+    // one octant of the shell as the three face slabs of ShellSampler:
+    // depth axis and the extents of the two lateral axes
+    struct Slab {
+        G4int axis, lateral1, lateral2;
+        G4double extent1, extent2;
+    };
+    const Slab slabs[3] = {{2, 0, 1, outer, outer},   // z: full outer face
+                           {1, 0, 2, outer, inner},   // y: outer in x, inner in z
+                           {0, 1, 2, inner, inner}};  // x: inner face
+
+    const std::size_t nCrystal = crystal.w.size();
+    const G4double* cx = crystal.x.data();
+    const G4double* cy = crystal.y.data();
+    const G4double* cz = crystal.z.data();
+    const G4double* cw = crystal.w.data();
+    const G4double tiny = 1.e-12 * mm;
+
+    G4double sumUncollided = 0., sumScattered = 0.;
+    for (const auto& slab : slabs) {
+        for (G4int i = 0; i < fDepthPoints; ++i) {
+            for (G4int j = 0; j < fLateralPoints; ++j) {
+                for (G4int l = 0; l < fLateralPoints; ++l) {
+                    G4double p[3];
+                    p[slab.axis] = depth[i];
+                    p[slab.lateral1] = lateralX[j] * slab.extent1;
+                    p[slab.lateral2] = lateralX[l] * slab.extent2;
+                    G4double weight = depthWeight[i] * lateralW[j] * slab.extent1 * lateralW[l] * slab.extent2;
+
+                    // the crystal is inside every box, so each ray from p
+                    // enters a box once and stays in it: the path in a layer
+                    // is the difference of the entry fractions of its boxes
+                    G4double pointUncollided = 0., pointScattered = 0.;
+                    for (std::size_t n = 0; n < nCrystal; ++n) {
+                        G4double vx = cx[n] - p[0], vy = cy[n] - p[1], vz = cz[n] - p[2];
+                        G4double r2 = vx * vx + vy * vy + vz * vz;
+                        G4double r = std::sqrt(r2);
+                        G4double ax = std::abs(vx) + tiny, ay = std::abs(vy) + tiny, az = std::abs(vz) + tiny;
+
+                        G4double mfpCu = 0., mfpPb = 0., previous = 0.;
+                        for (G4int k = layer; k >= 0; --k) {
+                            G4double b = bound[k];
+                            G4double t = std::max({std::max(p[0] - b, 0.) / ax,
+                                                   std::max(p[1] - b, 0.) / ay,
+                                                   std::max(p[2] - b, 0.) / az});
+                            G4double path = (t - previous) * r * mu[k];
+                            (lead[k] ? mfpPb : mfpCu) += path;
+                            previous = t;
+                        }
+
+                        // crystal entry: radial (x, z) and axial (y)
+                        G4double a = vx * vx + vz * vz;
+                        G4double bq = p[0] * vx + p[2] * vz;
+                        G4double c = p[0] * p[0] + p[2] * p[2] - radius * radius;
+                        G4double disc = std::max(bq * bq - a * c, 0.);
+                        G4double tRadial = (c > 0.) ? (-bq - std::sqrt(disc)) / std::max(a, tiny * tiny) : 0.;
+                        G4double tAxial = std::max(std::abs(p[1]) - halfLength, 0.) / ay;
+                        G4double inGe = (1. - std::max({tRadial, tAxial, previous})) * r;
+
+                        G4double mfp = mfpCu + mfpPb;
+                        G4double value = cw[n] * muGe * std::exp(-mfp - muGe * inGe) / (4. * pi * r2);
+                        pointUncollided += value;
+                        if (fBuildup) {
+                            pointScattered += value * Buildup(mfpPb >= mfpCu ? buildupPb : buildupCu, mfp);
+                        }
+                    }
+                    sumUncollided += weight * pointUncollided;
+                    sumScattered += weight * pointScattered;
+                }
+            }
+        }
+    }
+
+    // eight octants over the shell volume
+    G4double volume = 8. * (outer * outer * outer - inner * inner * inner);
+    uncollided = 8. * sumUncollided / volume;
+    scattered = 8. * sumScattered / volume;
+}
+
+void PointKernel::Run()
+{
+    if (!fDetector->GetLayerMaterial(0)) {
+        G4Exception("PointKernel::Run", "NoGeometry", JustWarning,
+                    "No geometry yet, run /run/initialize first.");
+        return;
+    }
+    if (fLines.empty()) {
+        G4Exception("PointKernel::Run", "NoLines", JustWarning,
+                    "No gamma lines, add them with /Shielding/pointKernel/line.");
+        return;
+    }
+
+    G4Timer timer;
+    timer.Start();
+
+    Crystal crystal;
+    std::vector<G4double> radialX, radialW, axialX, axialW;
+    GaussLegendre(kRadialPoints, radialX, radialW);
+    GaussLegendre(kAxialPoints, axialX, axialW);
+    G4double radius = fDetector->GetHPGeRadius();
+    G4double halfLength = fDetector->GetHPGeHalfLength();
+    for (G4int i = 0; i < kRadialPoints; ++i) {
+        G4double rho = radialX[i] * radius;
+        for (G4int j = 0; j < kAzimuthPoints; ++j) {
+            G4double phi = twopi * (j + 0.5) / kAzimuthPoints;
+            for (G4int l = 0; l < kAxialPoints; ++l) {
+                crystal.x.push_back(rho * std::cos(phi));
+                crystal.y.push_back((2. * axialX[l] - 1.) * halfLength);
+                crystal.z.push_back(rho * std::sin(phi));
+                crystal.w.push_back(radialW[i] * rho * radius * twopi / kAzimuthPoints
+                                    * axialW[l] * 2. * halfLength);
+            }
+        }
+    }
+
+    G4double time = fDetector->GetSimulationTime();
+    G4double densityCu = fDetector->GetLayerMaterial(1)->GetDensity();
+    G4double densityPb = fDetector->GetLayerMaterial(3)->GetDensity();
+    G4double densityGe = G4NistManager::Instance()->FindOrBuildMaterial("G4_Ge")->GetDensity();
+
+    G4cout << "[PointKernel] Geometry " << fDetector->GetGeometryKey() << ", " << fDepthPoints << "x"
+           << fLateralPoints << "x" << fLateralPoints << " nodes per face slab, " << crystal.w.size()
+           << " in the crystal" << G4endl;
+    for (const auto& line : fLines) {
+        G4cout << "[PointKernel] " << line.energy / keV << " keV, yield " << line.yield
+               << ", peak fraction " << line.peakFraction << "; mean free path Cu "
+               << 1. / (MassAttenuation(kMuCu, line.energy) * densityCu) / mm << " mm, Pb "
+               << 1. / (MassAttenuation(kMuPb, line.energy) * densityPb) / mm << " mm, Ge "
+               << 1. / (MassAttenuation(kMuGe, line.energy) * densityGe) / mm << " mm" << G4endl;
+        G4cout << "[PointKernel] " << std::setw(8) << "layer" << std::setw(12) << "Bq/kg"
+               << std::setw(14) << "per photon" << std::setw(14) << "peak /s";
+        if (fBuildup) G4cout << std::setw(14) << "build-up /s";
+        if (time > 0.) G4cout << std::setw(14) << "peak counts";
+        G4cout << G4endl;
+
+        G4double totalPeak = 0., totalScattered = 0.;
+        for (G4int layer = 0; layer < 4; ++layer) {
+            G4double inner, outer;
+            fDetector->GetLayerBounds(layer, inner, outer);
+            G4double mass = fDetector->GetLayerMaterial(layer)->GetDensity()
+                          * 8. * (outer * outer * outer - inner * inner * inner);
+            G4double activity = fDetector->GetLayerActivity(layer);
+            G4double photons = activity * mass / kg * line.yield; // per second
+
+            G4double uncollided = 0., scattered = 0.;
+            Integrate(layer, line, crystal, uncollided, scattered);
+            G4double peak = photons * uncollided * line.peakFraction;
+            totalPeak += peak;
+            totalScattered += photons * scattered;
+
+            G4cout << "[PointKernel] " << std::setw(8) << kLayerNames[layer] << std::setw(12) << activity
+                   << std::setw(14) << uncollided * line.peakFraction << std::setw(14) << peak;
+            if (fBuildup) G4cout << std::setw(14) << photons * scattered;
+            if (time > 0.) G4cout << std::setw(14) << peak * time;
+            G4cout << G4endl;
+        }
+        G4cout << "[PointKernel] " << std::setw(8) << "total" << std::setw(12) << "" << std::setw(14) << ""
+               << std::setw(14) << totalPeak;
+        if (fBuildup) G4cout << std::setw(14) << totalScattered;
+        if (time > 0.) G4cout << std::setw(14) << totalPeak * time;
+        G4cout << G4endl;
+    }
+
+    timer.Stop();
+    G4cout << "[PointKernel] " << fLines.size() << " lines x 4 layers in " << timer.GetRealElapsed()
+           << " s" << G4endl;
+}
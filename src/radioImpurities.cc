@@ -6,12 +6,26 @@
 
 namespace RadioImpurities {
 
+  // Isotopes, elements and materials are looked up before being created, so
+  // geometry rebuilds (parameter sweeps) reuse them instead of piling up
+  // duplicates and new material-cuts couples.
+
   static G4Isotope* MakeIsotope(const G4String& name, G4int Z, G4int A, G4double mass) {
+    if (auto isotope = G4Isotope::GetIsotope(name, false)) return isotope;
     return new G4Isotope(name, Z, A, mass*g/mole);
   }
 
+  static G4Element* MakeElement(const G4String& name, const G4String& symbol, G4Isotope* isotope) {
+    if (auto element = G4Element::GetElement(name, false)) return element;
+    G4Element* element = new G4Element(name, symbol, 1);
+    element->AddIsotope(isotope, 100.*perCent);
+    return element;
+  }
+
   // puer copper
   G4Material* CreateUltraPureCopper() {
+    if (auto existing = G4Material::GetMaterial("UltraPureCopper", false)) return existing;
+
     G4NistManager* nist = G4NistManager::Instance();
     G4Material* Cu = nist->FindOrBuildMaterial("G4_Cu");
 
@@ -22,6 +36,8 @@ namespace RadioImpurities {
 
   // less pure copper
   G4Material* CreateImpureCopper() {
+    if (auto existing = G4Material::GetMaterial("ImpureCopper", false)) return existing;
+
     G4NistManager* nist = G4NistManager::Instance();
     G4Material* Cu = nist->FindOrBuildMaterial("G4_Cu");
 
@@ -30,14 +46,9 @@ namespace RadioImpurities {
     G4Isotope* Th232 = MakeIsotope("Th232", 90, 232, 232.038);
     G4Isotope* Co60 = MakeIsotope("Co60", 27, 60, 59.9338);
 
-    G4Element* elU = new G4Element("Uranium", "U", 1);
-    elU->AddIsotope(U238, 100.*perCent);
-
-    G4Element* elTh = new G4Element("Thorium", "Th", 1);
-    elTh->AddIsotope(Th232, 100.*perCent);
-
-    G4Element* elCo60 = new G4Element("Cobalt60", "Co60", 1);
-    elCo60->AddIsotope(Co60, 100.*perCent);
+    G4Element* elU = MakeElement("Uranium", "U", U238);
+    G4Element* elTh = MakeElement("Thorium", "Th", Th232);
+    G4Element* elCo60 = MakeElement("Cobalt60", "Co60", Co60);
 
     G4Material* impureCu = new G4Material("ImpureCopper", 8.96*g/cm3, 4);
     impureCu->AddMaterial(Cu, 99.999999*perCent); 
@@ -50,12 +61,13 @@ namespace RadioImpurities {
 
   // pure-ish lead
   G4Material* CreateLowBackgroundLead() {
+    if (auto existing = G4Material::GetMaterial("LowBackgroundLead", false)) return existing;
+
     G4NistManager* nist = G4NistManager::Instance();
     G4Material* Pb = nist->FindOrBuildMaterial("G4_Pb");
 
     G4Isotope* Pb210 = MakeIsotope("Pb210", 82, 210, 209.984);
-    G4Element* elPb210 = new G4Element("Lead210", "Pb210", 1);
-    elPb210->AddIsotope(Pb210, 100.*perCent);
+    G4Element* elPb210 = MakeElement("Lead210", "Pb210", Pb210);
 
     G4Material* lowPb = new G4Material("LowBackgroundLead", 11.34*g/cm3, 2);
     lowPb->AddMaterial(Pb, 99.999999*perCent);
@@ -66,12 +78,13 @@ namespace RadioImpurities {
 
   // ipure lead
   G4Material* CreateImpureLead() {
+    if (auto existing = G4Material::GetMaterial("ImpureLead", false)) return existing;
+
     G4NistManager* nist = G4NistManager::Instance();
     G4Material* Pb = nist->FindOrBuildMaterial("G4_Pb");
 
     G4Isotope* Pb210 = MakeIsotope("Pb210", 82, 210, 209.984);
-    G4Element* elPb210 = new G4Element("Lead210", "Pb210", 1);
-    elPb210->AddIsotope(Pb210, 100.*perCent);
+    G4Element* elPb210 = MakeElement("Lead210", "Pb210", Pb210);
 
     G4Material* impurePb = new G4Material("ImpureLead", 11.34*g/cm3, 2);
     impurePb->AddMaterial(Pb, 99.999*perCent);
@@ -0,0 +1,157 @@
+#include "responseCache.hh"
+#include "responseMatrix.hh"
+#include "detectorShielding.hh"
+#include "decayChain.hh"
+#include "phaseSpace.hh"
+#include "sourceConfig.hh"
+#include "trackCuts.hh"
+#include "physicsTableCache.hh"
+#include "G4VModularPhysicsList.hh"
+#include "G4VPhysicsConstructor.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+G4String ResponseCache::fPhysicsListName = "unknown";
+
+ResponseCache::ResponseCache(detectorShielding* det)
+    : fDetector(det),
+      fChain(nullptr),
+      fPhaseSpace(nullptr),
+      fPhysList(nullptr),
+      fSource(nullptr),
+      fCuts(nullptr),
+      fDirectory("response"),
+      fArmed(false),
+      fMessenger(nullptr)
+{
+    fMessenger = new G4GenericMessenger(this, "/Shielding/response/", "Layer/isotope response cache");
+
+    fMessenger->DeclareMethod("dir", &ResponseCache::SetDirectory)
+        .SetGuidance("Root directory of the response cache (default: response)")
+        .SetParameterName("dir", false)
+        .SetToBeBroadcasted(false);
+
+    // /Shielding/response/record Cu1 Th232
+    fMessenger->DeclareMethod("record", &ResponseCache::Record)
+        .SetGuidance("Store the EventEnergy spectrum of the next run, normalised per decay,")
+        .SetGuidance("as the response of <layer> <isotope>. The GPS source must emit that")
+        .SetGuidance("isotope in that layer. Combine entries with the 'combine' tool.")
+        .SetParameterName("layer_isotope", false)
+        .SetToBeBroadcasted(false);
+}
+
+ResponseCache::~ResponseCache()
+{
+    delete fMessenger;
+}
+
+void ResponseCache::SetDirectory(const G4String& dir)
+{
+    fDirectory = dir;
+}
+
+void ResponseCache::Record(const G4String& input)
+{
+    std::istringstream is(input);
+    G4String layer, isotope;
+    is >> layer >> isotope;
+
+    if (fDetector->GetLayerIndex(layer) < 0 || isotope.empty()) {
+        G4Exception("ResponseCache::Record", "BadLayer", JustWarning,
+                    "Usage: /Shielding/response/record <Cu1|Cu2|Pb1|Pb2> <isotope>");
+        return;
+    }
+    if (fDetector->IsImportanceBiasing()) {
+        G4Exception("ResponseCache::Record", "Biased", JustWarning,
+                    "Importance-biased runs do not fill EventEnergy; run without -b to record a response.");
+        return;
+    }
+    fLayer = layer;
+    fIsotope = isotope;
+    fArmed = true;
+    G4cout << "[Response] Next run will be cached as " << fLayer << " " << fIsotope << G4endl;
+}
+
+G4String ResponseCache::GetKeyText() const
+{
+    std::ostringstream key;
+    key << "geometry " << fDetector->GetGeometryKey() << "\n"
+        << "physics " << fPhysicsListName << "\n";
+    if (fPhysList) {
+        for (G4int i = 0; fPhysList->GetPhysics(i); ++i) {
+            key << "constructor " << fPhysList->GetPhysics(i)->GetPhysicsName() << "\n";
+        }
+    }
+    // cuts of the run just done, whatever the macro set
+    key << PhysicsTableCache::GetCutsText();
+    if (fCuts) {
+        key << "stack " << fCuts->GetKillNeutrinos() << " " << fCuts->GetRangeCut() << " "
+            << fCuts->GetElectronMaxEnergy() / keV << " " << fCuts->GetTimeCut() / s << "\n";
+    }
+    if (fSource) {
+        key << "source " << (fSource->GetMode() == SourceConfig::Mode::Shell ? "shell " : "gps ")
+            << fSource->GetLayerName() << "\n";
+    }
+    if (fChain && fChain->IsActive()) {
+        key << "chain " << fChain->GetChainName() << " " << fChain->GetDecaysPerHead() << "\n";
+    }
+    if (fPhaseSpace && fPhaseSpace->IsReplaying()) {
+        key << "replay " << fPhaseSpace->GetOuterName() << " " << fPhaseSpace->GetLayerName() << "\n";
+    }
+    return key.str();
+}
+
+G4String ResponseCache::GetEntryDirectory() const
+{
+    return fDirectory + "/" + fDetector->GetGeometryKey() + "_" + fPhysicsListName + "_"
+        + PhysicsTableCache::HashText(GetKeyText());
+}
+
+void ResponseCache::EndOfRun(G4int nEvents)
+{
+    if (!fArmed) return;
+    fArmed = false;
+
+    auto h1 = G4AnalysisManager::Instance()->GetH1(1);
+    if (!h1 || nEvents <= 0) {
+        G4Exception("ResponseCache::EndOfRun", "NoSpectrum", JustWarning,
+                    "No EventEnergy spectrum to cache.");
+        return;
+    }
+
+    // a chain-source event is one member decay, not one chain-head decay
+    G4double decays = nEvents;
+    if (fPhaseSpace) decays *= fPhaseSpace->GetDecaysPerEvent();
+    if (fChain && fChain->IsActive()) decays /= fChain->GetDecaysPerHead();
+
+    ResponseMatrix::Entry entry;
+    entry.layer = fLayer;
+    entry.isotope = fIsotope;
+    entry.massKg = fDetector->GetLayerMass(fLayer);
+    entry.decays = decays;
+    entry.nBins = h1->axis().bins();
+    entry.eMinKeV = h1->axis().lower_edge() / keV;
+    entry.eMaxKeV = h1->axis().upper_edge() / keV;
+    entry.value.resize(entry.nBins);
+    entry.sigma.resize(entry.nBins);
+    for (G4int i = 0; i < entry.nBins; ++i) {
+        entry.value[i] = h1->bin_height(i) / decays;
+        entry.sigma[i] = h1->bin_error(i) / decays;
+    }
+
+    G4String dir = GetEntryDirectory();
+    std::error_code ec;
+    std::filesystem::create_directories(dir.c_str(), ec);
+    std::ofstream((dir + "/key.txt").c_str()) << GetKeyText();
+    G4String fileName = ResponseMatrix::EntryFileName(dir, fLayer, fIsotope);
+    if (!ResponseMatrix::Write(fileName, entry)) {
+        G4Exception("ResponseCache::EndOfRun", "WriteFailed", JustWarning,
+                    ("Cannot write " + fileName).c_str());
+        return;
+    }
+    G4cout << "[Response] Cached " << fLayer << " " << fIsotope << " response ("
+           << decays << " decays) in " << fileName << G4endl;
+}
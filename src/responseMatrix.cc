@@ -0,0 +1,116 @@
+#include "responseMatrix.hh"
+
+#include <fstream>
+#include <sstream>
+#include <cmath>
+
+namespace ResponseMatrix {
+
+  G4String EntryFileName(const G4String& dir, const G4String& layer, const G4String& isotope) {
+    return dir + "/" + layer + "_" + isotope + ".txt";
+  }
+
+  G4bool Write(const G4String& fileName, const Entry& entry) {
+    std::ofstream out(fileName);
+    if (!out) return false;
+
+    out << "# HPGe EventEnergy response per decay\n";
+    out << "layer " << entry.layer << "\n";
+    out << "isotope " << entry.isotope << "\n";
+    out << "mass_kg " << entry.massKg << "\n";
+    out << "decays " << entry.decays << "\n";
+    out << "bins " << entry.nBins << " " << entry.eMinKeV << " " << entry.eMaxKeV << "\n";
+    out << "# bin counts_per_decay sigma (non-empty bins only)\n";
+    out.precision(10);
+    for (G4int i = 0; i < entry.nBins; ++i) {
+      if (entry.value[i] == 0.) continue;
+      out << i << " " << entry.value[i] << " " << entry.sigma[i] << "\n";
+    }
+    return out.good();
+  }
+
+  G4bool Read(const G4String& fileName, Entry& entry) {
+    std::ifstream in(fileName);
+    if (!in) return false;
+
+    entry = Entry();
+    std::string line;
+    while (std::getline(in, line)) {
+      if (line.empty() || line[0] == '#') continue;
+      std::istringstream is(line);
+      std::string key;
+      is >> key;
+      if (key == "layer") is >> entry.layer;
+      else if (key == "isotope") is >> entry.isotope;
+      else if (key == "mass_kg") is >> entry.massKg;
+      else if (key == "decays") is >> entry.decays;
+      else if (key == "bins") {
+        is >> entry.nBins >> entry.eMinKeV >> entry.eMaxKeV;
+        entry.value.assign(entry.nBins, 0.);
+        entry.sigma.assign(entry.nBins, 0.);
+      }
+      else {
+        G4int bin = std::stoi(key);
+        if (bin < 0 || bin >= entry.nBins) return false;
+        is >> entry.value[bin] >> entry.sigma[bin];
+      }
+    }
+    return entry.nBins > 0;
+  }
+
+  G4bool ReadActivities(const G4String& fileName, std::vector<Activity>& activities) {
+    std::ifstream in(fileName);
+    if (!in) return false;
+
+    std::string line;
+    while (std::getline(in, line)) {
+      line = line.substr(0, line.find('#'));
+      std::istringstream is(line);
+      Activity a;
+      if (is >> a.layer >> a.isotope >> a.bqPerKg) activities.push_back(a);
+    }
+    return true;
+  }
+
+  G4bool Combine(const G4String& dir, const std::vector<Activity>& activities, G4double liveTime,
+                 Entry& spectrum) {
+    spectrum = Entry();
+    spectrum.layer = "all";
+    spectrum.isotope = "all";
+
+    std::vector<G4double> variance;
+    for (const auto& a : activities) {
+      Entry entry;
+      if (!Read(EntryFileName(dir, a.layer, a.isotope), entry)) {
+        G4cerr << "[Response] No cached response for " << a.layer << " " << a.isotope
+               << " in " << dir << G4endl;
+        return false;
+      }
+      if (spectrum.nBins == 0) {
+        spectrum.nBins = entry.nBins;
+        spectrum.eMinKeV = entry.eMinKeV;
+        spectrum.eMaxKeV = entry.eMaxKeV;
+        spectrum.value.assign(entry.nBins, 0.);
+        variance.assign(entry.nBins, 0.);
+      } else if (entry.nBins != spectrum.nBins) {
+        G4cerr << "[Response] Binning mismatch for " << a.layer << " " << a.isotope << G4endl;
+        return false;
+      }
+
+      // decays in the live time for this layer and isotope
+      G4double decays = a.bqPerKg * entry.massKg * liveTime;
+      spectrum.decays += decays;
+      for (G4int i = 0; i < entry.nBins; ++i) {
+        spectrum.value[i] += decays * entry.value[i];
+        variance[i] += decays * decays * entry.sigma[i] * entry.sigma[i];
+      }
+    }
+
+    spectrum.sigma.resize(variance.size());
+    for (std::size_t i = 0; i < variance.size(); ++i) {
+      spectrum.sigma[i] = std::sqrt(variance[i]);
+    }
+    return spectrum.nBins > 0;
+  }
+
+}
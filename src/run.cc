@@ -0,0 +1,432 @@
+#include "run.hh"
+#include "generator.hh"
+#include "stacking.hh"
+#include "tracking.hh"
+#include "convergence.hh"
+#include "responseCache.hh"
+#include "phaseSpace.hh"
+#include "stepProfiler.hh"
+#include "fluxTally.hh"
+#include "asyncWriter.hh"
+#include "sourceModel.hh"
+#include "leadTransport.hh"
+#include "nextEvent.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4AccumulableManager.hh"
+
+#include <filesystem>
+#include <sstream>
+#include <cmath>
+
+G4int MyRunAction::fJobIndex = 0;
+G4int MyRunAction::fNJobs = 1;
+G4long MyRunAction::fSeed = 0;
+G4String MyRunAction::fJobSuffix = "";
+G4bool MyRunAction::fImportanceBiasing = false;
+G4bool MyRunAction::fStartUpPending = false;
+G4double MyRunAction::fInitialiseSeconds = 0.;
+std::chrono::steady_clock::time_point MyRunAction::fInitialised;
+
+MyRunAction::MyRunAction(MyPrimaryGenerator* generator, MyStackingAction* stacking,
+                         MyTrackingAction* tracking, ResponseCache* response,
+                         ConvergenceMonitor* convergence, PhaseSpace* phaseSpace,
+                         StepProfiler* profiler, FluxTally* flux, AsyncWriter* writer,
+                         SourceModel* model, LeadTransport* transport,
+                         NextEventEstimator* nextEvent)
+    : fGenerator(generator),
+      fStacking(stacking),
+      fTracking(tracking),
+      fResponse(response),
+      fConvergence(convergence),
+      fPhaseSpace(phaseSpace),
+      fProfiler(profiler),
+      fFlux(flux),
+      fWriter(writer),
+      fModel(model),
+      fTransport(transport),
+      fNextEvent(nextEvent),
+      fOutputLevel("hits"),
+      fMessenger(nullptr)
+{
+    auto accumulableManager = G4AccumulableManager::Instance();
+    accumulableManager->RegisterAccumulable(fNVertices);
+    accumulableManager->RegisterAccumulable(fVertexTime);
+    accumulableManager->RegisterAccumulable(fNTracks);
+    for (auto& killed : fNKilled) accumulableManager->RegisterAccumulable(killed);
+    accumulableManager->RegisterAccumulable(fNSteps);
+    for (auto& score : fHistoryScore) accumulableManager->RegisterAccumulable(score);
+    for (auto& score2 : fHistoryScore2) accumulableManager->RegisterAccumulable(score2);
+
+    auto analysisManager = G4AnalysisManager::Instance();
+
+    // one output file: worker ntuples are merged into the master's file
+    analysisManager->SetNtupleMerging(true);
+    // inactive ntuples are neither filled nor written (see SetOutputLevel)
+    analysisManager->SetActivation(true);
+
+    // Create output file name - will be overridden by macro if specified
+    G4String outputdir = "/home/bmiles/miniconda3/envs/geant4_env/share/Geant4/bramGeant4/hPGeShield/root/";
+    G4String outputFileName = "default.root";
+    analysisManager->SetFileName(outputdir + outputFileName);
+
+    // Create histograms
+    analysisManager->CreateH1("HitEnergy", "Energy per Hit in HPGe", 6000, 0., 3.*MeV);
+    analysisManager->CreateH1("EventEnergy", "Total Energy per Event in HPGe", 6000, 0., 3.*MeV);
+
+    // Track-length flux per layer, rebinned and activated by FluxTally
+    for (auto layer : {"Cu1", "Cu2", "Pb1", "Pb2", "HPGe"}) {
+        analysisManager->CreateH1(G4String("Flux_") + layer,
+                                  G4String("Track length per event in ") + layer + " (mm)", 300, 0., 3.*MeV);
+    }                                                        // H1 IDs 2-6
+
+    // Expected first interactions in the HPGe, activated by NextEventEstimator
+    analysisManager->CreateH1("NEE_Interaction", "Expected first interactions in HPGe per event",
+                              6000, 0., 3.*MeV);             // H1 ID 7
+    analysisManager->CreateH1("NEE_Peak", "Estimated full-energy peak counts per event",
+                              6000, 0., 3.*MeV);             // H1 ID 8
+
+    // Create ntuple for detailed hit information
+    analysisManager->CreateNtuple("Hits", "Individual Hit Data");
+    analysisManager->CreateNtupleIColumn("EventID");         // 0: Event ID
+    analysisManager->CreateNtupleFColumn("Energy_keV");      // 1: Energy (keV)
+    analysisManager->CreateNtupleIColumn("TrackID");         // 2: Track ID
+    analysisManager->CreateNtupleIColumn("PDG");             // 3: Particle PDG code
+    analysisManager->CreateNtupleDColumn("Time_ns");         // 4: Time of hit (ns)
+    analysisManager->CreateNtupleFColumn("Weight");          // 5: Track weight (1 unless biased)
+    analysisManager->FinishNtuple();                         // Ntuple ID 0
+
+    // Create ntuple for event summary
+    analysisManager->CreateNtuple("Events", "Event Summary");
+    analysisManager->CreateNtupleIColumn("EventID");         // 0: Event ID
+    analysisManager->CreateNtupleFColumn("TotalEnergy_keV"); // 1: Total energy (keV)
+    analysisManager->CreateNtupleIColumn("NHits");           // 2: Number of hits
+    analysisManager->CreateNtupleFColumn("Weight");          // 3: Event weight (1; not filled when biased)
+    analysisManager->CreateNtupleIColumn("SourceLayer");     // 4: Cu1=0 ... Pb2=3 (/Shielding/model/), else -1
+    analysisManager->CreateNtupleIColumn("SourcePDG");       // 5: Ion PDG code (/Shielding/model/), else 0
+    analysisManager->FinishNtuple();                         // Ntuple ID 1
+
+    // Create ntuple for the ROI precision reached, filled by the master
+    analysisManager->CreateNtuple("Convergence", "ROI precision of the run");
+    analysisManager->CreateNtupleDColumn("LowKeV");          // 0: ROI lower edge (keV)
+    analysisManager->CreateNtupleDColumn("HighKeV");         // 1: ROI upper edge (keV)
+    analysisManager->CreateNtupleDColumn("Counts");          // 2: Weighted counts
+    analysisManager->CreateNtupleDColumn("RelError");        // 3: Relative uncertainty
+    analysisManager->CreateNtupleDColumn("Target");          // 4: Requested precision
+    analysisManager->CreateNtupleDColumn("Events");          // 5: Events simulated
+    analysisManager->CreateNtupleDColumn("Seconds");         // 6: Wall-clock time (s)
+    analysisManager->FinishNtuple();                         // Ntuple ID 2
+
+    // Create ntuple for the run bookkeeping used by the merge tool, filled by the master
+    analysisManager->CreateNtuple("RunInfo", "Run and job summary");
+    analysisManager->CreateNtupleDColumn("NEvents");         // 0: Events in this run
+    analysisManager->CreateNtupleIColumn("JobIndex");        // 1: Job index (sim --job i/N)
+    analysisManager->CreateNtupleIColumn("NJobs");           // 2: Number of jobs
+    analysisManager->CreateNtupleDColumn("Seed");            // 3: Base seed (sim --seed)
+    analysisManager->FinishNtuple();                         // Ntuple ID 3
+
+    // Create ntuple for per-track lengths, filled by FluxTally when enabled
+    analysisManager->CreateNtuple("Tracks", "Track length per layer");
+    analysisManager->CreateNtupleIColumn("EventID");         // 0: Event ID
+    analysisManager->CreateNtupleIColumn("TrackID");         // 1: Track ID
+    analysisManager->CreateNtupleIColumn("PDG");             // 2: Particle PDG code
+    analysisManager->CreateNtupleFColumn("Energy_keV");      // 3: Initial kinetic energy (keV)
+    analysisManager->CreateNtupleFColumn("Length_Cu1_mm");   // 4-8: Track length per layer (mm)
+    analysisManager->CreateNtupleFColumn("Length_Cu2_mm");
+    analysisManager->CreateNtupleFColumn("Length_Pb1_mm");
+    analysisManager->CreateNtupleFColumn("Length_Pb2_mm");
+    analysisManager->CreateNtupleFColumn("Length_HPGe_mm");
+    analysisManager->CreateNtupleIColumn("FinalVolume");     // 9: Cu1=0 Cu2=1 Pb1=2 Pb2=3 HPGe=4, other -1
+    analysisManager->FinishNtuple();                         // Ntuple ID 4
+
+    fMessenger = new G4GenericMessenger(this, "/Shielding/output/", "Output file controls");
+
+    // /Shielding/output/level spectra|events|hits
+    fMessenger->DeclareMethod("level", &MyRunAction::SetOutputLevel)
+        .SetGuidance("spectra: HitEnergy/EventEnergy histograms only")
+        .SetGuidance("events : histograms + Events ntuple")
+        .SetGuidance("hits   : histograms + Events and Hits ntuples (default)")
+        .SetParameterName("level", false)
+        .SetCandidates("spectra events hits");
+
+    fMessenger->DeclareMethod("compression", &MyRunAction::SetCompressionLevel)
+        .SetGuidance("ROOT compression level (0-9), before the output file is opened")
+        .SetParameterName("level", false)
+        .SetRange("level>=0 && level<=9");
+
+    fMessenger->DeclareMethod("basketSize", &MyRunAction::SetBasketSize)
+        .SetGuidance("ROOT ntuple basket size in bytes, before the output file is opened")
+        .SetParameterName("bytes", false)
+        .SetRange("bytes>0");
+}
+
+MyRunAction::~MyRunAction()
+{
+    delete fMessenger;
+}
+
+void MyRunAction::SetJob(G4int index, G4int nJobs, G4long seed, const G4String& suffix)
+{
+    fJobIndex = index;
+    fNJobs = nJobs;
+    fSeed = seed;
+    fJobSuffix = suffix;
+}
+
+G4String MyRunAction::GetJobBaseName(const G4String& fileName)
+{
+    G4String base = fileName;
+    if (base.size() > 5 && base.substr(base.size() - 5) == ".root") base = base.substr(0, base.size() - 5);
+    if (!fJobSuffix.empty() && base.find(fJobSuffix) == std::string::npos) base += fJobSuffix;
+    return base;
+}
+
+void MyRunAction::SetStartUp(G4double initialiseSeconds)
+{
+    fInitialiseSeconds = initialiseSeconds;
+    fInitialised = std::chrono::steady_clock::now();
+    fStartUpPending = true;
+}
+
+void MyRunAction::SetOutputLevel(const G4String& level)
+{
+    fOutputLevel = level;
+
+    auto analysisManager = G4AnalysisManager::Instance();
+    analysisManager->SetNtupleActivation(0, level == "hits");
+    analysisManager->SetNtupleActivation(1, level != "spectra");
+
+    if (IsMaster()) {
+        G4cout << "[Output] Output level set to " << level << G4endl;
+    }
+}
+
+void MyRunAction::SetCompressionLevel(G4int level)
+{
+    G4AnalysisManager::Instance()->SetCompressionLevel(level);
+}
+
+void MyRunAction::SetBasketSize(G4int bytes)
+{
+    G4AnalysisManager::Instance()->SetBasketSize(static_cast<unsigned int>(bytes));
+}
+
+void MyRunAction::AddHistory(const std::vector<G4double>& hitEnergies, const std::vector<G4double>& hitWeights,
+                             G4double eventEnergy, G4bool eventScoring)
+{
+    // what this history adds to the in-range bins of HitEnergy and EventEnergy
+    G4double score[2] = {0., 0.};
+    for (std::size_t i = 0; i < hitEnergies.size(); ++i) {
+        if (hitEnergies[i] >= fLow[0] && hitEnergies[i] < fHigh[0]) score[0] += hitWeights[i];
+    }
+    if (eventScoring && eventEnergy > 0. && eventEnergy >= fLow[1] && eventEnergy < fHigh[1]) score[1] = 1.;
+
+    for (G4int id = 0; id < 2; ++id) {
+        if (score[id] == 0.) continue;
+        fHistoryScore[id] += score[id];
+        fHistoryScore2[id] += score[id] * score[id];
+    }
+}
+
+void MyRunAction::PrintFigureOfMerit(G4int nEvents)
+{
+    // FOM = 1/(R^2 T) of the HitEnergy and EventEnergy spectrum integrals,
+    // with R from the per-history scores (events are the independent
+    // samples); importance-biased runs do not fill EventEnergy, so they
+    // compare with the HitEnergy line of an analogue run. T is the wall time
+    // of the event loop (the timer is stopped again after the output is
+    // written)
+    fTimer.Stop();
+    G4double seconds = fTimer.GetRealElapsed();
+    if (nEvents < 2) return;
+
+    const char* names[2] = {"HitEnergy", "EventEnergy"};
+    const G4double n = nEvents;
+    for (G4int id = 0; id < (fImportanceBiasing ? 1 : 2); ++id) {
+        G4double mean = fHistoryScore[id].GetValue() / n;
+        if (mean <= 0.) {
+            G4cout << "[Biasing] No energy deposited in the HPGe, FOM undefined" << G4endl;
+            return;
+        }
+        G4double variance = std::max(0., (fHistoryScore2[id].GetValue() / n - mean * mean) * n / (n - 1.));
+        G4double relError = std::sqrt(variance / n) / mean;
+        G4cout << "[Biasing] " << names[id] << " entries per decay: " << mean
+               << " +- " << relError * 100. << " %" << G4endl;
+        if (seconds > 0. && relError > 0.) {
+            G4cout << "[Biasing] " << names[id] << " FOM = 1/(R^2 T) = "
+                   << 1. / (relError * relError * seconds) << " /s (T = " << seconds << " s)" << G4endl;
+        }
+    }
+}
+
+void MyRunAction::BeginOfRunAction(const G4Run* run)
+{
+    // the master's first BeginOfRunAction follows the physics-table build
+    if (IsMaster() && fStartUpPending) {
+        fStartUpPending = false;
+        G4double setUp = std::chrono::duration<G4double>(std::chrono::steady_clock::now() - fInitialised).count();
+        G4cout << "[Run] First beamOn set-up (geometry, physics tables): " << setUp << " s; start-up to the "
+               << "first event: " << fInitialiseSeconds + setUp << " s" << G4endl;
+    }
+    G4AccumulableManager::Instance()->Reset();
+    for (G4int id = 0; id < 2; ++id) {
+        auto h1 = G4AnalysisManager::Instance()->GetH1(id);
+        fLow[id] = h1 ? h1->axis().lower_edge() : 0.;
+        fHigh[id] = h1 ? h1->axis().upper_edge() : 0.;
+    }
+    if (fGenerator) fGenerator->ResetVertexStatistics();
+    if (fStacking) fStacking->ResetCounters();
+    if (fTracking) fTracking->ResetCounters();
+    fFlux->BeginOfRun();
+    if (IsMaster()) {
+        fConvergence->BeginOfRun();
+        fPhaseSpace->BeginOfRun();
+        fProfiler->BeginOfRun();
+        fWriter->BeginOfRun();
+        // alias table for the current layer masses, read by the workers
+        fModel->Prepare();
+        // Pb2 table for the current geometry, read by the fast models
+        fTransport->BeginOfRun();
+    }
+    // after the Pb2 table, whose use changes the scored sites
+    fNextEvent->BeginOfRun();
+
+    auto analysisManager = G4AnalysisManager::Instance();
+
+    // split jobs write <file>_jobNNN.root, whatever name the macro chose
+    G4String fileName = analysisManager->GetFileName();
+    if (!fJobSuffix.empty() && fileName.find(fJobSuffix) == std::string::npos) {
+        analysisManager->SetFileName(GetJobBaseName(fileName) + ".root");
+    }
+
+    // macros may already have issued /analysis/openFile
+    if (!analysisManager->IsOpenFile()) {
+        // a later run into an unchanged file name would overwrite the earlier
+        // output: it writes <file>_runN.root instead
+        fileName = analysisManager->GetFileName();
+        if (fileName == fLastFileName) {
+            std::ostringstream suffixed;
+            suffixed << fBaseFileName << "_run" << run->GetRunID() << ".root";
+            analysisManager->SetFileName(suffixed.str());
+        } else {
+            fBaseFileName = fileName;
+            if (fBaseFileName.size() > 5 && fBaseFileName.substr(fBaseFileName.size() - 5) == ".root") {
+                fBaseFileName = fBaseFileName.substr(0, fBaseFileName.size() - 5);
+            }
+        }
+        fLastFileName = analysisManager->GetFileName();
+        analysisManager->OpenFile();
+    }
+
+    fTimer.Start();
+}
+
+void MyRunAction::EndOfRunAction(const G4Run* run)
+{
+    // rows still queued for this thread's writer go in before anything else
+    // touches the ntuples
+    fWriter->Drain();
+    if (IsMaster()) fWriter->EndOfRun();
+
+    if (fGenerator) {
+        fNVertices += fGenerator->GetNVertices();
+        fVertexTime += fGenerator->GetVertexTime();
+    }
+    if (fTracking) fNSteps += fTracking->GetNSteps();
+    if (fStacking) {
+        fNTracks += fStacking->GetNTracks();
+        for (G4int i = 0; i < MyStackingAction::kNKillClasses; ++i) {
+            fNKilled[i] += fStacking->GetNKilled(i);
+        }
+    }
+    G4AccumulableManager::Instance()->Merge();
+
+    auto analysisManager = G4AnalysisManager::Instance();
+
+    // calibration histories of a sequential run are on the master thread
+    fTransport->Flush();
+    fNextEvent->Flush();
+
+    // phase-space particles are on disk before the response is normalised
+    if (IsMaster()) {
+        fTransport->EndOfRun();
+        fPhaseSpace->EndOfRun(run->GetNumberOfEvent());
+        fProfiler->EndOfRun(run->GetNumberOfEvent());
+        fFlux->EndOfRun(run->GetNumberOfEvent());
+        fNextEvent->EndOfRun(run->GetNumberOfEvent());
+    } else {
+        fPhaseSpace->Flush();
+        fProfiler->Flush();
+    }
+
+    // worker histograms were merged into the master's by their Write()
+    if (IsMaster() && fResponse) {
+        fResponse->EndOfRun(run->GetNumberOfEvent());
+    }
+    if (IsMaster()) {
+        fConvergence->EndOfRun();
+
+        analysisManager->FillNtupleDColumn(3, 0, static_cast<G4double>(run->GetNumberOfEvent()));
+        analysisManager->FillNtupleIColumn(3, 1, fJobIndex);
+        analysisManager->FillNtupleIColumn(3, 2, fNJobs);
+        analysisManager->FillNtupleDColumn(3, 3, static_cast<G4double>(fSeed));
+        analysisManager->AddNtupleRow(3);
+    } else {
+        fConvergence->Flush();
+    }
+    if (IsMaster()) {
+        PrintFigureOfMerit(run->GetNumberOfEvent());
+    }
+
+    // on workers this merges histograms and flushes ntuple rows to the master
+    G4Timer writeTimer;
+    writeTimer.Start();
+    analysisManager->Write();
+    analysisManager->CloseFile();
+    writeTimer.Stop();
+    fTimer.Stop();
+
+    if (IsMaster()) {
+        G4int nEvents = run->GetNumberOfEvent();
+        G4cout << "[Run] " << nEvents << " events, ROOT output written to "
+               << analysisManager->GetFileName() << G4endl;
+        if (fTimer.GetRealElapsed() > 0.) {
+            G4cout << "[Run] Event loop: " << fTimer.GetRealElapsed() << " s, "
+                   << nEvents / fTimer.GetRealElapsed() << " events/s, "
+                   << fNSteps.GetValue() / fTimer.GetRealElapsed() << " steps/s ("
+                   << fNSteps.GetValue() << " steps)" << G4endl;
+        }
+
+        if (fVertexTime.GetValue() > 0.) {
+            G4cout << "[Run] Vertex generation: " << fNVertices.GetValue() << " vertices in "
+                   << fVertexTime.GetValue() << " s (summed over threads), "
+                   << fNVertices.GetValue() / fVertexTime.GetValue() << " vertices/s" << G4endl;
+        }
+
+        if (fNTracks.GetValue() > 0.) {
+            G4cout << "[Stacking] " << fNTracks.GetValue() << " secondaries, killed: "
+                   << fNKilled[MyStackingAction::kNeutrino].GetValue() << " neutrinos, "
+                   << fNKilled[MyStackingAction::kLate].GetValue() << " after time cut, "
+                   << fNKilled[MyStackingAction::kChainIon].GetValue() << " chain/model ions, "
+                   << fNKilled[MyStackingAction::kElectron].GetValue() << " electrons, "
+                   << fNKilled[MyStackingAction::kAlpha].GetValue() << " alphas/recoils" << G4endl;
+        }
+
+        // output cost of the chosen level: bytes per event and write rate
+        G4String fileName = analysisManager->GetFileName();
+        if (fileName.find(".root") == std::string::npos) fileName += ".root";
+        std::error_code ec;
+        auto bytes = std::filesystem::file_size(fileName.c_str(), ec);
+        G4double seconds = fTimer.GetRealElapsed();
+        G4double writeSeconds = writeTimer.GetRealElapsed();
+        if (!ec && nEvents > 0 && seconds > 0.) {
+            G4cout << "[Output] level=" << fOutputLevel << ": " << bytes << " bytes, "
+                   << static_cast<G4double>(bytes) / nEvents << " bytes/event, "
+                   << nEvents / seconds << " events/s" << G4endl;
+            // the master writes the merged file after the workers handed over their rows
+            if (writeSeconds > 0.) {
+                G4cout << "[Output] Write and close: " << writeSeconds << " s, "
+                       << bytes / writeSeconds / 1.e6 << " MB/s" << G4endl;
+            }
+        }
+    }
+}
@@ -0,0 +1,102 @@
+#include "runOptions.hh"
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+
+namespace {
+    std::uint64_t SplitMix64(std::uint64_t x)
+    {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+}
+
+void PrintUsage()
+{
+    G4cerr << "Usage: sim [macro] [-t nThreads] [-m serial|mt|tasking] [-p physics] [-b]" << G4endl
+           << "           [--resume checkpoint] [--seed S] [--job i/N] [--output file.root]" << G4endl
+           << "           [--fast-start dir] [--fast-pb2]" << G4endl
+           << "  no macro      : interactive session with visualisation" << G4endl
+           << "  -t nThreads   : worker threads (default: all cores when multithreaded)" << G4endl
+           << "  -m mode       : run manager type (default: serial, or tasking if -t > 1)" << G4endl
+           << "  -p physics    : ftfp (FTFP_BERT + radioactive decay, default)," << G4endl
+           << "                  livermore | option4 (EM + decay + radioactive decay only)" << G4endl
+           << "  -b            : gamma importance biasing (see /Shielding/biasing/)" << G4endl
+           << "  --resume file : continue /Shielding/autoBeamOn or /Shielding/beamOn from <file>_checkpoint.txt" << G4endl
+           << "  --seed S      : base random seed (default 0 when --job is given)" << G4endl
+           << "  --job i/N     : job i (0-based) of N; own RNG stream, files get _jobNNN" << G4endl
+           << "  --output file : default output file instead of root/default.root" << G4endl
+           << "  --fast-start d: store physics tables in d on the first run, retrieve them later" << G4endl
+           << "  --fast-pb2    : attach the Pb2 fast-simulation model (see /Shielding/fastPb2/)" << G4endl;
+}
+
+G4bool ParseRunOptions(G4int argc, char** argv, RunOptions& options)
+{
+    for (G4int i = 1; i < argc; ++i) {
+        G4String arg = argv[i];
+        G4bool hasValue = i + 1 < argc;
+        if (arg == "-t" && hasValue) {
+            options.nThreads = std::atoi(argv[++i]);
+        } else if (arg == "-m" && hasValue) {
+            options.mode = argv[++i];
+        } else if (arg == "-p" && hasValue) {
+            options.physics = argv[++i];
+        } else if (arg == "--resume" && hasValue) {
+            options.resume = argv[++i];
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = std::atol(argv[++i]);
+            options.seedSet = true;
+        } else if (arg == "--job" && hasValue) {
+            if (std::sscanf(argv[++i], "%d/%d", &options.jobIndex, &options.nJobs) != 2
+                || options.nJobs < 1 || options.jobIndex < 0 || options.jobIndex >= options.nJobs) {
+                return false;
+            }
+        } else if (arg == "--output" && hasValue) {
+            options.output = argv[++i];
+        } else if (arg == "--fast-start" && hasValue) {
+            options.fastStart = argv[++i];
+        } else if (arg == "--fast-pb2") {
+            options.fastPb2 = true;
+        } else if (arg == "-b") {
+            options.biasing = true;
+        } else if (arg == "-h" || arg == "--help") {
+            options.help = true;
+        } else if (options.macroFile.empty() && arg[0] != '-') {
+            options.macroFile = arg;
+        } else {
+            return false;
+        }
+    }
+
+    if (options.physics != "ftfp" && options.physics != "livermore" && options.physics != "option4") {
+        return false;
+    }
+    if (!options.mode.empty() && options.mode != "serial" && options.mode != "mt"
+        && options.mode != "tasking") {
+        return false;
+    }
+    return true;
+}
+
+void DeriveJobSeeds(G4long seed, G4int jobIndex, long seeds[3])
+{
+    std::uint64_t state = SplitMix64(static_cast<std::uint64_t>(seed));
+    state = SplitMix64(state ^ SplitMix64(static_cast<std::uint64_t>(jobIndex) + 1));
+    // Geant4 engines take positive long seeds
+    seeds[0] = static_cast<long>(state & 0x7fffffffULL);
+    seeds[1] = static_cast<long>((state >> 32) & 0x7fffffffULL);
+    if (seeds[0] == 0) seeds[0] = 1;
+    if (seeds[1] == 0) seeds[1] = 1;
+    seeds[2] = 0;
+}
+
+G4String JobSuffix(const RunOptions& options)
+{
+    if (options.nJobs <= 1) return "";
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), "_job%03d", options.jobIndex);
+    return suffix;
+}
@@ -1,15 +1,26 @@
 #include "sensitiveDetector.hh"
+#include "asyncWriter.hh"
+#include "sourceModel.hh"
 #include "G4Step.hh"
 #include "G4Track.hh"
 #include "G4RunManager.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Gamma.hh"
 #include <iomanip>
 
-SensitiveDetector::SensitiveDetector(const G4String& name)
+SensitiveDetector::SensitiveDetector(const G4String& name, AsyncWriter* writer)
   : G4VSensitiveDetector(name),
     fTotalEnergyDeposit(0.0),
-    fNHits(0)
-{}
+    fNHits(0),
+    fEventScoring(true),
+    fGamma(G4Gamma::Definition()),
+    fWriter(writer)
+{
+  fHitEnergy.reserve(64);
+  fHitTrackID.reserve(64);
+  fHitTime.reserve(64);
+  fHitWeight.reserve(64);
+}
 
 SensitiveDetector::~SensitiveDetector()
 {}
@@ -18,49 +29,64 @@ void SensitiveDetector::Initialize(G4HCofThisEvent*)
 {
   fTotalEnergyDeposit = 0.0;
   fNHits = 0;
+  fHitEnergy.clear();
+  fHitTrackID.clear();
+  fHitTime.clear();
+  fHitWeight.clear();
 }
 
 G4bool SensitiveDetector::ProcessHits(G4Step* step, G4TouchableHistory*)
 {
-    //auto particle = step->GetTrack()->GetParticleDefinition()->GetParticleName();
-    //if (particle != "gamma") 
-        //return false;
-    
     G4double edep = step->GetTotalEnergyDeposit();
     if (edep == 0.) return false;
 
+    // every particle contributes to the event energy ...
     fTotalEnergyDeposit += edep;
-    fNHits++;
-
-    auto analysisManager = G4AnalysisManager::Instance();
-    
-    std::string particleName = step->GetTrack()->GetParticleDefinition()->GetParticleName();
-    if (particleName != "gamma") return false;
 
-    analysisManager->FillNtupleDColumn(0, 0, edep);
-    analysisManager->FillNtupleDColumn(0, 1, edep/keV); 
-    analysisManager->FillNtupleDColumn(0, 2, step->GetTrack()->GetTrackID());
-    analysisManager->FillNtupleSColumn(0, 3, particleName);
-    analysisManager->FillNtupleDColumn(0, 4, step->GetPreStepPoint()->GetGlobalTime()/ns);
-    analysisManager->AddNtupleRow(0);
+    // ... but only gamma steps are recorded as hits
+    G4Track* track = step->GetTrack();
+    if (track->GetParticleDefinition() != fGamma) return false;
 
-    analysisManager->FillH1(0, edep);
+    fHitEnergy.push_back(edep);
+    fHitTrackID.push_back(track->GetTrackID());
+    fHitTime.push_back(step->GetPreStepPoint()->GetGlobalTime());
+    fHitWeight.push_back(step->GetPreStepPoint()->GetWeight());
     
     return true;
 }
 
 void SensitiveDetector::EndOfEvent(G4HCofThisEvent*)
 {
+    if (fTotalEnergyDeposit <= 0) return;
+
     auto analysisManager = G4AnalysisManager::Instance();
-    G4int eventID = G4RunManager::GetRunManager()->GetCurrentEvent()->GetEventID();
-    
-    if (fTotalEnergyDeposit > 0) {
-        analysisManager->FillNtupleDColumn(1, 0, eventID);            
-        analysisManager->FillNtupleDColumn(1, 1, fTotalEnergyDeposit);  
-        analysisManager->FillNtupleDColumn(1, 2, fTotalEnergyDeposit/keV); 
-        analysisManager->FillNtupleDColumn(1, 3, fNHits);      
-        analysisManager->AddNtupleRow(1);
-        
-        analysisManager->FillH1(1, fTotalEnergyDeposit);
+    const G4Event* event = G4RunManager::GetRunManager()->GetCurrentEvent();
+    G4int eventID = event->GetEventID();
+
+    fNHits = static_cast<G4int>(fHitEnergy.size());
+    const G4int pdg = fGamma->GetPDGEncoding();
+    // Hits/Events ntuples are deactivated by /Shielding/output/level
+    G4bool writeHits = analysisManager->GetNtupleActivation(0);
+    G4bool writeEvent = fEventScoring && analysisManager->GetNtupleActivation(1);
+    for (G4int i = 0; i < fNHits; ++i) analysisManager->FillH1(0, fHitEnergy[i], fHitWeight[i]);
+    if (fEventScoring) analysisManager->FillH1(1, fTotalEnergyDeposit);
+
+    if (writeHits) {
+        for (G4int i = 0; i < fNHits; ++i) {
+            // EventID, Energy_keV, TrackID, PDG, Time_ns, Weight
+            fWriter->AddRow(0, {static_cast<G4double>(eventID), fHitEnergy[i]/keV,
+                                static_cast<G4double>(fHitTrackID[i]), static_cast<G4double>(pdg),
+                                fHitTime[i]/ns, fHitWeight[i]});
+        }
+    }
+
+    if (writeEvent) {
+        // (layer, nuclide) of /Shielding/model/ events, -1 and 0 otherwise
+        auto label = dynamic_cast<const SourceLabel*>(event->GetUserInformation());
+        // EventID, TotalEnergy_keV, NHits, Weight, SourceLayer, SourcePDG
+        fWriter->AddRow(1, {static_cast<G4double>(eventID), fTotalEnergyDeposit/keV,
+                            static_cast<G4double>(fNHits), 1.,
+                            static_cast<G4double>(label ? label->GetLayer() : -1),
+                            static_cast<G4double>(label ? label->GetPDG() : 0)});
     }
   }
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include "shellSampler.hh"
+#include "Randomize.hh"
+
+ShellSampler::ShellSampler()
+    : fInner(0.), fOuter(0.), fWeightOuterFace(0.), fWeightBand(0.), fWeightTotal(0.)
+{}
+
+ShellSampler::~ShellSampler()
+{}
+
+void ShellSampler::SetShell(G4double inner, G4double outer)
+{
+    if (inner < 0. || outer <= inner) {
+        G4Exception("ShellSampler::SetShell", "BadShell", FatalException,
+                    "Shell outer half-length must exceed the inner half-length.");
+    }
+    fInner = inner;
+    fOuter = outer;
+
+    // slab volumes / (4 (outer - inner)): outer^2, outer*inner and inner^2
+    fWeightOuterFace = outer * outer;
+    fWeightBand      = outer * inner;
+    fWeightTotal     = fWeightOuterFace + fWeightBand + inner * inner;
+}
+
+G4double ShellSampler::GetVolume() const
+{
+    return 8. * (fOuter * fOuter * fOuter - fInner * fInner * fInner);
+}
+
+G4ThreeVector ShellSampler::Sample() const
+{
+    // pick the slab pair by volume, then the side
+    G4double r = G4UniformRand() * fWeightTotal;
+    G4double side = (G4UniformRand() < 0.5) ? -1. : 1.;
+    G4double depth = side * (fInner + (fOuter - fInner) * G4UniformRand());
+
+    G4double u = 2. * G4UniformRand() - 1.;
+    G4double v = 2. * G4UniformRand() - 1.;
+
+    if (r < fWeightOuterFace) {
+        // z slabs: full outer face in x and y
+        return G4ThreeVector(u * fOuter, v * fOuter, depth);
+    }
+    if (r < fWeightOuterFace + fWeightBand) {
+        // y slabs: full outer extent in x, inner extent in z
+        return G4ThreeVector(u * fOuter, depth, v * fInner);
+    }
+    // x slabs: inner extent in y and z
+    return G4ThreeVector(depth, u * fInner, v * fInner);
+}
@@ -0,0 +1,52 @@
+#include "sourceConfig.hh"
+#include "detectorShielding.hh"
+
+SourceConfig::SourceConfig(const detectorShielding* det)
+    : fDetector(det),
+      fMode(Mode::GPS),
+      fLayer(0),
+      fLayerName("Cu1"),
+      fMessenger(nullptr)
+{
+    fMessenger = new G4GenericMessenger(this, "/Shielding/source/", "Primary vertex placement");
+
+    // /Shielding/source/mode gps|shell
+    fMessenger->DeclareMethod("mode", &SourceConfig::SetMode)
+        .SetGuidance("gps  : positions from GPS (/gps/pos/confine, rejection sampling)")
+        .SetGuidance("shell: exact uniform sampling inside /Shielding/source/layer;")
+        .SetGuidance("       use /gps/pos/type Point so GPS does no rejection of its own")
+        .SetParameterName("mode", false)
+        .SetCandidates("gps shell")
+        .SetToBeBroadcasted(false);
+
+    // /Shielding/source/layer Cu1|Cu2|Pb1|Pb2
+    fMessenger->DeclareMethod("layer", &SourceConfig::SetLayer)
+        .SetGuidance("Shielding layer sampled in shell mode")
+        .SetParameterName("layer", false)
+        .SetCandidates("Cu1 Cu2 Pb1 Pb2")
+        .SetToBeBroadcasted(false);
+}
+
+SourceConfig::~SourceConfig()
+{
+    delete fMessenger;
+}
+
+void SourceConfig::SetMode(const G4String& mode)
+{
+    fMode = (mode == "shell") ? Mode::Shell : Mode::GPS;
+    G4cout << "[Source] Vertex mode set to " << mode << G4endl;
+}
+
+void SourceConfig::SetLayer(const G4String& layer)
+{
+    G4int index = fDetector->GetLayerIndex(layer);
+    if (index < 0) {
+        G4Exception("SourceConfig::SetLayer", "BadLayer", JustWarning,
+                    "Unknown layer name, keeping previous source layer.");
+        return;
+    }
+    fLayer = index;
+    fLayerName = layer;
+    G4cout << "[Source] Shell source layer set to " << fLayerName << G4endl;
+}
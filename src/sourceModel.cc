@@ -0,0 +1,150 @@
+#include "sourceModel.hh"
+#include "detectorShielding.hh"
+#include "G4NistManager.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <cctype>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+    const char* kLayerNames[4] = {"Cu1", "Cu2", "Pb1", "Pb2"};
+    // entries are ground states; as DecayChain
+    const G4double kLevelTolerance = 1.*keV;
+
+    // "Pb214" -> (82, 214); ground states only
+    G4bool ParseNuclide(const G4String& name, G4int& Z, G4int& A)
+    {
+        std::size_t digits = 0;
+        while (digits < name.size() && std::isalpha(static_cast<unsigned char>(name[digits]))) ++digits;
+        if (digits == 0 || digits == name.size()) return false;
+        for (std::size_t i = digits; i < name.size(); ++i) {
+            if (!std::isdigit(static_cast<unsigned char>(name[i]))) return false;
+        }
+        Z = G4NistManager::Instance()->GetZ(name.substr(0, digits));
+        A = std::atoi(name.substr(digits).c_str());
+        return Z > 0 && A >= Z;
+    }
+}
+
+SourceModel::SourceModel(detectorShielding* det)
+    : fDetector(det),
+      fVersion(0),
+      fPrepared(false),
+      fMessenger(nullptr)
+{
+    fMessenger = new G4GenericMessenger(this, "/Shielding/model/", "Multi-layer, multi-nuclide source");
+
+    // /Shielding/model/add Pb2 Pb214 10
+    fMessenger->DeclareMethod("add", &SourceModel::AddEntry)
+        .SetGuidance("<layer> <nuclide> <Bq/kg>, e.g. Pb2 Pb214 10. Each event decays one entry,")
+        .SetGuidance("drawn by activity x layer mass, at rest in its layer; replaces the GPS")
+        .SetGuidance("particle, the chain source and shell mode while the model has entries.")
+        .SetParameterName("layer_nuclide_activity", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("clear", &SourceModel::Clear)
+        .SetGuidance("Remove all entries (back to the GPS source)")
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("print", &SourceModel::Print)
+        .SetGuidance("List the entries with their decay rates for the current geometry")
+        .SetToBeBroadcasted(false);
+}
+
+SourceModel::~SourceModel()
+{
+    delete fMessenger;
+}
+
+void SourceModel::AddEntry(const G4String& input)
+{
+    std::istringstream is(input);
+    G4String layer, nuclide;
+    G4double activity = -1.;
+    is >> layer >> nuclide >> activity;
+
+    Entry entry{fDetector->GetLayerIndex(layer), nuclide, 0, 0, activity, 0.};
+    if (entry.layer < 0 || activity < 0. || !ParseNuclide(nuclide, entry.Z, entry.A)) {
+        G4Exception("SourceModel::AddEntry", "BadEntry", JustWarning,
+                    "Usage: /Shielding/model/add <Cu1|Cu2|Pb1|Pb2> <nuclide, e.g. Pb214> <Bq/kg >= 0>");
+        return;
+    }
+    fEntries.push_back(entry);
+    fPrepared = false;
+    G4cout << "[Model] " << layer << " " << nuclide << " " << activity << " Bq/kg added ("
+           << fEntries.size() << " entries)" << G4endl;
+}
+
+void SourceModel::Clear()
+{
+    fEntries.clear();
+    fTable.Build({});
+    ++fVersion;
+    fPrepared = false;
+    G4cout << "[Model] Source model cleared" << G4endl;
+}
+
+G4double SourceModel::Prepare()
+{
+    if (fEntries.empty()) return 0.;
+
+    // autoBeamOn and the run action both prepare the same run
+    G4String geometry = fDetector->GetGeometryKey();
+    if (fPrepared && geometry == fPreparedGeometry) return IsActive() ? fTable.GetTotalWeight() : 0.;
+    fPrepared = true;
+    fPreparedGeometry = geometry;
+
+    // one mass per layer, GetLayerMass reports each calculation
+    G4double mass[4] = {-1., -1., -1., -1.};
+    std::vector<G4double> weights(fEntries.size());
+    for (std::size_t i = 0; i < fEntries.size(); ++i) {
+        Entry& entry = fEntries[i];
+        if (mass[entry.layer] < 0.) mass[entry.layer] = fDetector->GetLayerMass(kLayerNames[entry.layer]);
+        entry.decays = entry.activity * mass[entry.layer];
+        weights[i] = entry.decays;
+    }
+    ++fVersion;
+
+    if (!fTable.Build(weights)) {
+        G4Exception("SourceModel::Prepare", "NoActivity", JustWarning,
+                    "All source model activities are zero, model source disabled.");
+        return 0.;
+    }
+    Print();
+    return fTable.GetTotalWeight();
+}
+
+G4bool SourceModel::IsEntry(G4int layer, G4int Z, G4int A, G4double excitation) const
+{
+    if (excitation >= kLevelTolerance) return false;
+    for (const auto& entry : fEntries) {
+        if (entry.layer == layer && entry.Z == Z && entry.A == A) return true;
+    }
+    return false;
+}
+
+void SourceModel::Print() const
+{
+    G4double total = 0.;
+    for (const auto& entry : fEntries) total += entry.decays;
+
+    G4cout << "[Model] " << fEntries.size() << " entries";
+    if (total > 0.) G4cout << ", " << total << " decays/s in total";
+    G4cout << G4endl;
+    for (const auto& entry : fEntries) {
+        G4cout << "[Model]   " << std::setw(4) << kLayerNames[entry.layer] << " " << std::setw(7)
+               << entry.nuclide << " " << std::setw(10) << entry.activity << " Bq/kg";
+        if (total > 0.) {
+            G4cout << " " << std::setw(12) << entry.decays << " decays/s  "
+                   << std::setw(8) << 100. * entry.decays / total << " %";
+        }
+        G4cout << G4endl;
+    }
+}
+
+void SourceLabel::Print() const
+{
+    G4cout << "[Model] Event source: layer " << fLayer << ", PDG " << fPDG << G4endl;
+}
@@ -0,0 +1,146 @@
+#include "stacking.hh"
+#include "detectorShielding.hh"
+#include "decayChain.hh"
+#include "sourceModel.hh"
+#include "trackCuts.hh"
+#include "G4Ions.hh"
+#include "G4Electron.hh"
+#include "G4Alpha.hh"
+#include "G4EmCalculator.hh"
+#include "G4EventManager.hh"
+#include "G4Event.hh"
+#include "G4NuclideTable.hh"
+
+#include <cmath>
+
+MyStackingAction::MyStackingAction(const detectorShielding* det, const DecayChain* chain,
+                                   const SourceModel* model, const TrackCuts* cuts)
+    : fDetector(det),
+      fChain(chain),
+      fModel(model),
+      fCuts(cuts),
+      fCalculator(new G4EmCalculator()),
+      fCavityHalf(0.),
+      fModelLayer(-1)
+{
+    ResetCounters();
+}
+
+MyStackingAction::~MyStackingAction()
+{
+    delete fCalculator;
+}
+
+void MyStackingAction::ResetCounters()
+{
+    fNTracks = 0;
+    for (auto& n : fNKilled) n = 0;
+}
+
+void MyStackingAction::PrepareNewEvent()
+{
+    G4double outer;
+    fDetector->GetLayerBounds(0, fCavityHalf, outer);
+
+    fShellMaterials.clear();
+    for (G4int layer = 0; layer < 4; ++layer) {
+        if (auto material = fDetector->GetLayerMaterial(layer)) fShellMaterials.push_back(material);
+    }
+
+    // the primaries, and their label, are generated before this
+    fModelLayer = -1;
+    if (fModel->IsActive()) {
+        auto event = G4EventManager::GetEventManager()->GetConstCurrentEvent();
+        auto label = event ? dynamic_cast<const SourceLabel*>(event->GetUserInformation()) : nullptr;
+        if (label) fModelLayer = label->GetLayer();
+    }
+}
+
+G4bool MyStackingAction::StopsBeforeCavity(const G4Track* track) const
+{
+    // distance from the vertex to the cavity box, through the shield
+    const G4ThreeVector& pos = track->GetPosition();
+    G4double dx = std::max(0., std::abs(pos.x()) - fCavityHalf);
+    G4double dy = std::max(0., std::abs(pos.y()) - fCavityHalf);
+    G4double dz = std::max(0., std::abs(pos.z()) - fCavityHalf);
+    G4double distance = std::sqrt(dx*dx + dy*dy + dz*dz);
+    if (distance <= 0.) return false;
+
+    // longest range over the shield materials, since the path may cross any
+    // of them; the restricted range is never shorter than the CSDA range
+    const G4ParticleDefinition* particle = track->GetParticleDefinition();
+    G4double energy = track->GetKineticEnergy();
+    for (auto material : fShellMaterials) {
+        if (fCalculator->GetRangeFromRestricteDEDX(energy, particle, material) >= distance) {
+            return false;
+        }
+    }
+    return !fShellMaterials.empty();
+}
+
+G4bool MyStackingAction::IsStableIon(const G4Ions* ion) const
+{
+    // GetPDGStable() is true for radioactive ions too, which RDM decays
+    // through its own tables: only a ground state the nuclide table lists
+    // without a finite lifetime never decays (recoil daughters such as
+    // Pb214 or Bi214 must live to emit their gammas)
+    if (ion->GetExcitationEnergy() > 0.) return false;
+    auto property = G4NuclideTable::GetNuclideTable()->GetIsotope(ion->GetAtomicNumber(),
+                                                                  ion->GetAtomicMass(), 0.);
+    if (!property) return false;
+    G4double lifetime = property->GetLifeTime();
+    return lifetime < 0. || std::isinf(lifetime);
+}
+
+G4ClassificationOfNewTrack MyStackingAction::ClassifyNewTrack(const G4Track* track)
+{
+    if (track->GetParentID() == 0) return fUrgent;
+    ++fNTracks;
+
+    const G4ParticleDefinition* particle = track->GetParticleDefinition();
+
+    if (fCuts->GetKillNeutrinos()) {
+        G4int pdg = std::abs(particle->GetPDGEncoding());
+        if (pdg == 12 || pdg == 14 || pdg == 16) {
+            ++fNKilled[kNeutrino];
+            return fKill;
+        }
+    }
+
+    if (fCuts->GetTimeCut() > 0. && track->GetGlobalTime() > fCuts->GetTimeCut()) {
+        ++fNKilled[kLate];
+        return fKill;
+    }
+
+    auto ion = particle->IsGeneralIon() ? static_cast<const G4Ions*>(particle) : nullptr;
+
+    // excited daughters are kept so their de-excitation gammas are emitted;
+    // the member state they end in is killed when it is created
+    if (ion && fChain->IsActive() &&
+        fChain->IsMember(ion->GetAtomicNumber(), ion->GetAtomicMass(), ion->GetExcitationEnergy())) {
+        ++fNKilled[kChainIon];
+        return fKill;
+    }
+    // likewise the entries of a source model layer, e.g. Bi214 from Pb214
+    if (ion && fModelLayer >= 0 &&
+        fModel->IsEntry(fModelLayer, ion->GetAtomicNumber(), ion->GetAtomicMass(), ion->GetExcitationEnergy())) {
+        ++fNKilled[kChainIon];
+        return fKill;
+    }
+
+    if (fCuts->GetRangeCut()) {
+        if (particle == G4Electron::Definition()) {
+            if (track->GetKineticEnergy() < fCuts->GetElectronMaxEnergy() && StopsBeforeCavity(track)) {
+                ++fNKilled[kElectron];
+                return fKill;
+            }
+        } else if (particle == G4Alpha::Definition() || (ion && IsStableIon(ion))) {
+            if (StopsBeforeCavity(track)) {
+                ++fNKilled[kAlpha];
+                return fKill;
+            }
+        }
+    }
+
+    return fUrgent;
+}
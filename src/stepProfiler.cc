@@ -0,0 +1,168 @@
+#include "stepProfiler.hh"
+#include "G4Step.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4VProcess.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+
+G4ThreadLocal StepProfiler::Local* StepProfiler::fLocal = nullptr;
+
+StepProfiler::StepProfiler()
+    : fEnabled(false),
+      fOutput("profile.json"),
+      fRows(25),
+      fMessenger(nullptr)
+{
+    fMessenger = new G4GenericMessenger(this, "/Shielding/profile/", "Step and time profile of the event loop");
+
+    fMessenger->DeclareMethod("enable", &StepProfiler::SetEnabled)
+        .SetGuidance("Count steps and wall time per (volume, particle, process) (default false)")
+        .SetParameterName("enable", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("output", &StepProfiler::SetOutput)
+        .SetGuidance("JSON file written at the end of each profiled run (default profile.json)")
+        .SetParameterName("fileName", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("rows", &StepProfiler::SetRows)
+        .SetGuidance("Rows of the printed (volume, particle, process) table (default 25)")
+        .SetParameterName("rows", false)
+        .SetRange("rows>0")
+        .SetToBeBroadcasted(false);
+}
+
+StepProfiler::~StepProfiler()
+{
+    delete fMessenger;
+}
+
+void StepProfiler::BeginOfRun()
+{
+    fTotal.clear();
+    fStart = std::chrono::steady_clock::now();
+}
+
+void StepProfiler::StartTrack()
+{
+    if (!fLocal) fLocal = new Local();
+    fLocal->last = std::chrono::steady_clock::now();
+}
+
+void StepProfiler::AddStep(const G4Step* step)
+{
+    auto now = std::chrono::steady_clock::now();
+    if (!fLocal) {
+        fLocal = new Local();
+        fLocal->last = now;
+    }
+
+    LocalKey key(step->GetPreStepPoint()->GetPhysicalVolume(),
+                 step->GetTrack()->GetParticleDefinition(),
+                 step->GetPostStepPoint()->GetProcessDefinedStep());
+    Entry& entry = fLocal->entries[key];
+    ++entry.steps;
+    entry.seconds += std::chrono::duration<G4double>(now - fLocal->last).count();
+    fLocal->last = now;
+}
+
+void StepProfiler::Flush()
+{
+    if (!fLocal || fLocal->entries.empty()) return;
+
+    // names are resolved while this run's volumes still exist
+    G4AutoLock lock(&fMutex);
+    for (const auto& [key, entry] : fLocal->entries) {
+        auto volume = std::get<0>(key);
+        auto particle = std::get<1>(key);
+        auto process = std::get<2>(key);
+        Entry& total = fTotal[Key(volume ? volume->GetName() : G4String("OutOfWorld"),
+                                  particle ? particle->GetParticleName() : G4String("unknown"),
+                                  process ? process->GetProcessName() : G4String("none"))];
+        total.steps += entry.steps;
+        total.seconds += entry.seconds;
+    }
+    fLocal->entries.clear();
+}
+
+void StepProfiler::EndOfRun(G4int nEvents)
+{
+    if (!fEnabled) return;
+    Flush(); // sequential mode: the master is also the worker
+
+    G4double elapsed = std::chrono::duration<G4double>(std::chrono::steady_clock::now() - fStart).count();
+    G4long steps = 0;
+    G4double stepSeconds = 0.;
+    std::map<G4String, Entry> volumes;
+    for (const auto& [key, entry] : fTotal) {
+        steps += entry.steps;
+        stepSeconds += entry.seconds;
+        Entry& volume = volumes[std::get<0>(key)];
+        volume.steps += entry.steps;
+        volume.seconds += entry.seconds;
+    }
+
+    G4cout << "[Profile] " << nEvents << " events in " << elapsed << " s, "
+           << (elapsed > 0. ? nEvents / elapsed : 0.) << " events/s, "
+           << (nEvents > 0 ? static_cast<G4double>(steps) / nEvents : 0.) << " steps/event, "
+           << stepSeconds << " s in steps (summed over threads)" << G4endl;
+    if (steps == 0) return;
+
+    G4cout << "[Profile] " << std::setw(12) << "volume" << std::setw(12) << "steps"
+           << std::setw(10) << "time %" << std::setw(12) << "us/step" << G4endl;
+    for (const auto& [name, entry] : volumes) {
+        G4cout << "[Profile] " << std::setw(12) << name << std::setw(12) << entry.steps
+               << std::setw(10) << std::setprecision(3) << 100. * entry.seconds / stepSeconds
+               << std::setw(12) << 1.e6 * entry.seconds / entry.steps << G4endl;
+    }
+
+    // most expensive combinations first
+    std::vector<std::pair<Key, Entry>> rows(fTotal.begin(), fTotal.end());
+    std::sort(rows.begin(), rows.end(),
+              [](const auto& a, const auto& b) { return a.second.seconds > b.second.seconds; });
+    G4cout << "[Profile] " << std::setw(12) << "volume" << std::setw(14) << "particle"
+           << std::setw(18) << "process" << std::setw(12) << "steps" << std::setw(10) << "time %"
+           << std::setw(12) << "us/step" << G4endl;
+    for (std::size_t i = 0; i < rows.size() && i < static_cast<std::size_t>(fRows); ++i) {
+        const auto& [key, entry] = rows[i];
+        G4cout << "[Profile] " << std::setw(12) << std::get<0>(key) << std::setw(14) << std::get<1>(key)
+               << std::setw(18) << std::get<2>(key) << std::setw(12) << entry.steps
+               << std::setw(10) << std::setprecision(3) << 100. * entry.seconds / stepSeconds
+               << std::setw(12) << 1.e6 * entry.seconds / entry.steps << G4endl;
+    }
+    G4cout << std::setprecision(6);
+
+    if (!fOutput.empty()) WriteJson(nEvents, elapsed, steps);
+}
+
+void StepProfiler::WriteJson(G4int nEvents, G4double seconds, G4long steps) const
+{
+    std::ofstream out(fOutput);
+    if (!out) {
+        G4Exception("StepProfiler::WriteJson", "CannotWrite", JustWarning,
+                    ("Cannot write profile to " + fOutput).c_str());
+        return;
+    }
+
+    // names are Geant4 identifiers, no escaping needed
+    out << "{\n"
+        << "  \"events\": " << nEvents << ",\n"
+        << "  \"seconds\": " << seconds << ",\n"
+        << "  \"eventsPerSecond\": " << (seconds > 0. ? nEvents / seconds : 0.) << ",\n"
+        << "  \"stepsPerEvent\": " << (nEvents > 0 ? static_cast<G4double>(steps) / nEvents : 0.) << ",\n"
+        << "  \"entries\": [";
+    G4bool first = true;
+    for (const auto& [key, entry] : fTotal) {
+        out << (first ? "\n" : ",\n")
+            << "    {\"volume\": \"" << std::get<0>(key) << "\", \"particle\": \"" << std::get<1>(key)
+            << "\", \"process\": \"" << std::get<2>(key) << "\", \"steps\": " << entry.steps
+            << ", \"seconds\": " << entry.seconds << "}";
+        first = false;
+    }
+    out << "\n  ]\n}\n";
+    G4cout << "[Profile] Written to " << fOutput << G4endl;
+}
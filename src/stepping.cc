@@ -0,0 +1,43 @@
+#include "stepping.hh"
+#include "phaseSpace.hh"
+#include "stepProfiler.hh"
+#include "fluxTally.hh"
+#include "leadTransport.hh"
+#include "nextEvent.hh"
+#include "G4EventManager.hh"
+#include "G4Event.hh"
+#include "G4VPhysicalVolume.hh"
+
+MySteppingAction::MySteppingAction(PhaseSpace* phaseSpace, StepProfiler* profiler, FluxTally* flux,
+                                   LeadTransport* transport, NextEventEstimator* nextEvent)
+    : fPhaseSpace(phaseSpace),
+      fProfiler(profiler),
+      fFlux(flux),
+      fTransport(transport),
+      fNextEvent(nextEvent)
+{}
+
+MySteppingAction::~MySteppingAction()
+{}
+
+void MySteppingAction::UserSteppingAction(const G4Step* step)
+{
+    if (fProfiler->IsEnabled()) fProfiler->AddStep(step);
+    if (fFlux->IsEnabled()) fFlux->AddStep(step);
+    if (fTransport->IsCalibrating()) fTransport->AddStep(step);
+    if (fNextEvent->IsEnabled()) fNextEvent->AddStep(step);
+    if (!fPhaseSpace->IsRecording()) return;
+
+    // the shells touch, so the boundary is crossed in a single step with
+    // both the boolean and the nested geometry
+    G4StepPoint* post = step->GetPostStepPoint();
+    if (post->GetStepStatus() != fGeomBoundary) return;
+    G4VPhysicalVolume* postVolume = post->GetPhysicalVolume();
+    G4VPhysicalVolume* preVolume = step->GetPreStepPoint()->GetPhysicalVolume();
+    if (!postVolume || postVolume->GetName() != fPhaseSpace->GetLayerName() ||
+        preVolume->GetName() != fPhaseSpace->GetOuterName()) return;
+
+    G4Track* track = step->GetTrack();
+    fPhaseSpace->Record(track, G4EventManager::GetEventManager()->GetConstCurrentEvent()->GetEventID());
+    track->SetTrackStatus(fStopAndKill);
+}
@@ -0,0 +1,157 @@
+#include "sweep.hh"
+#include "detectorShielding.hh"
+#include "G4RunManager.hh"
+#include "G4UImanager.hh"
+#include "G4AnalysisManager.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <unistd.h>
+#include <limits>
+
+namespace {
+    // resident set size in MB, to check memory stays flat across points
+    G4double ResidentMB()
+    {
+        std::ifstream statm("/proc/self/statm");
+        long pages = 0, resident = 0;
+        if (!(statm >> pages >> resident)) return 0.;
+        return resident * static_cast<G4double>(sysconf(_SC_PAGESIZE)) / (1024. * 1024.);
+    }
+}
+
+ShieldingSweep::ShieldingSweep(detectorShielding* det)
+    : fDetector(det),
+      fEvents(0),
+      fOutput(""),
+      fMessenger(nullptr)
+{
+    fMessenger = new G4GenericMessenger(this, "/Shielding/sweep/", "In-process geometry sweep");
+
+    // /Shielding/sweep/add Pb2Thickness 50 100 150
+    fMessenger->DeclareMethod("add", &ShieldingSweep::AddParameter)
+        .SetGuidance("Add a sweep axis: <parameter> <values in mm...>, where parameter is one of")
+        .SetGuidance("Cu1Thickness Cu2Thickness Pb1Thickness Pb2Thickness cavityHalfX cavityHalfY cavityHalfZ.")
+        .SetGuidance("Points are the Cartesian product of all axes.")
+        .SetParameterName("axis", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("clear", &ShieldingSweep::Clear)
+        .SetGuidance("Remove all sweep axes")
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("events", &ShieldingSweep::SetEvents)
+        .SetGuidance("Events per point (default: /Shielding/setDecays or computed decays)")
+        .SetParameterName("events", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("output", &ShieldingSweep::SetOutput)
+        .SetGuidance("Output base name (default: current analysis file name)")
+        .SetParameterName("base", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("run", &ShieldingSweep::Run)
+        .SetGuidance("Run every point of the sweep")
+        .SetToBeBroadcasted(false);
+}
+
+ShieldingSweep::~ShieldingSweep()
+{
+    delete fMessenger;
+}
+
+void ShieldingSweep::AddParameter(const G4String& input)
+{
+    static const std::vector<std::pair<G4String, Setter>> setters = {
+        {"Cu1Thickness", &detectorShielding::SetInnerCu1Thickness},
+        {"Cu2Thickness", &detectorShielding::SetInnerCu2Thickness},
+        {"Pb1Thickness", &detectorShielding::SetOuterPb1Thickness},
+        {"Pb2Thickness", &detectorShielding::SetOuterPb2Thickness},
+        {"cavityHalfX",  &detectorShielding::SetCavityHalfX},
+        {"cavityHalfY",  &detectorShielding::SetCavityHalfY},
+        {"cavityHalfZ",  &detectorShielding::SetCavityHalfZ}
+    };
+
+    std::istringstream is(input);
+    Axis axis;
+    is >> axis.name;
+    axis.setter = nullptr;
+    for (const auto& entry : setters) {
+        if (entry.first == axis.name) axis.setter = entry.second;
+    }
+
+    G4double value;
+    while (is >> value) axis.values.push_back(value * mm);
+
+    if (!axis.setter || axis.values.empty()) {
+        G4Exception("ShieldingSweep::AddParameter", "BadAxis", JustWarning,
+                    "Usage: /Shielding/sweep/add <parameter> <values in mm...>");
+        return;
+    }
+    fAxes.push_back(axis);
+    G4cout << "[Sweep] Axis " << axis.name << " with " << axis.values.size() << " values" << G4endl;
+}
+
+void ShieldingSweep::Clear()
+{
+    fAxes.clear();
+}
+
+void ShieldingSweep::Run()
+{
+    G4long events = (fEvents > 0) ? fEvents : fDetector->GetTotalDecays();
+    if (events > std::numeric_limits<G4int>::max()) {
+        G4Exception("ShieldingSweep::Run", "TooManyEvents", JustWarning,
+                    "Decay budget exceeds one beamOn; set /Shielding/sweep/events.");
+        return;
+    }
+    if (fAxes.empty() || events <= 0) {
+        G4Exception("ShieldingSweep::Run", "NothingToRun", JustWarning,
+                    "Sweep needs at least one axis and a positive number of events.");
+        return;
+    }
+
+    auto analysisManager = G4AnalysisManager::Instance();
+    G4String base = fOutput.empty() ? analysisManager->GetFileName() : fOutput;
+    if (base.size() > 5 && base.substr(base.size() - 5) == ".root") base = base.substr(0, base.size() - 5);
+
+    std::ofstream points(base + "_points.txt");
+    points << "# point";
+    for (const auto& axis : fAxes) points << " " << axis.name << "_mm";
+    points << " file\n";
+
+    G4UImanager* UImanager = G4UImanager::GetUIpointer();
+    std::vector<std::size_t> index(fAxes.size(), 0);
+    for (G4int point = 0; ; ++point) {
+        std::ostringstream fileName;
+        fileName << base << "_" << std::setw(4) << std::setfill('0') << point << ".root";
+
+        points << point;
+        for (std::size_t a = 0; a < fAxes.size(); ++a) {
+            G4double value = fAxes[a].values[index[a]];
+            (fDetector->*fAxes[a].setter)(value);
+            points << " " << value / mm;
+        }
+        points << " " << fileName.str() << "\n";
+        points.flush();
+
+        // broadcast so worker threads switch file too
+        UImanager->ApplyCommand("/analysis/setFileName " + fileName.str());
+        G4RunManager::GetRunManager()->BeamOn(static_cast<G4int>(events));
+
+        G4cout << "[Sweep] Point " << point << " done (" << fileName.str() << "), resident memory "
+               << ResidentMB() << " MB" << G4endl;
+
+        // advance the odometer over all axes
+        std::size_t a = 0;
+        while (a < fAxes.size() && ++index[a] == fAxes[a].values.size()) {
+            index[a] = 0;
+            ++a;
+        }
+        if (a == fAxes.size()) break;
+    }
+
+    UImanager->ApplyCommand("/analysis/setFileName " + base + ".root");
+}
@@ -0,0 +1,64 @@
+#include "trackCuts.hh"
+#include "G4SystemOfUnits.hh"
+
+TrackCuts::TrackCuts()
+    : fKillNeutrinos(true),
+      fRangeCut(false),
+      fElectronMaxEnergy(200.*keV),
+      fTimeCut(0.),
+      fMessenger(nullptr)
+{
+    fMessenger = new G4GenericMessenger(this, "/Shielding/stack/", "Early kill of undetectable secondaries");
+
+    fMessenger->DeclareMethod("neutrinos", &TrackCuts::SetKillNeutrinos)
+        .SetGuidance("Kill all neutrinos when they are created (default true)")
+        .SetParameterName("kill", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethod("rangeCut", &TrackCuts::SetRangeCut)
+        .SetGuidance("Kill electrons, alphas and stable recoil ions whose range in the")
+        .SetGuidance("shield materials is shorter than their distance to the cavity (default")
+        .SetGuidance("false). Radioactive recoils are never cut, so decay chains are unchanged.")
+        .SetParameterName("enable", false)
+        .SetToBeBroadcasted(false);
+
+    // bremsstrahlung of killed electrons is lost, so only slow ones are cut
+    fMessenger->DeclareMethodWithUnit("electronMaxEnergy", "keV", &TrackCuts::SetElectronMaxEnergy)
+        .SetGuidance("Electrons above this energy are never range-cut (default 200 keV),")
+        .SetGuidance("since their bremsstrahlung may still reach the HPGe")
+        .SetParameterName("energy", false)
+        .SetToBeBroadcasted(false);
+
+    fMessenger->DeclareMethodWithUnit("timeCut", "s", &TrackCuts::SetTimeCut)
+        .SetGuidance("Kill secondaries created later than this global time, e.g. the")
+        .SetGuidance("long-lived tail of a full decay chain (0: no cut, default)")
+        .SetParameterName("time", false)
+        .SetToBeBroadcasted(false);
+}
+
+TrackCuts::~TrackCuts()
+{
+    delete fMessenger;
+}
+
+void TrackCuts::SetKillNeutrinos(G4bool kill)
+{
+    fKillNeutrinos = kill;
+}
+
+void TrackCuts::SetRangeCut(G4bool enable)
+{
+    fRangeCut = enable;
+}
+
+void TrackCuts::SetElectronMaxEnergy(G4double energy)
+{
+    fElectronMaxEnergy = energy;
+    G4cout << "[Stacking] Electron range cut below " << energy/keV << " keV" << G4endl;
+}
+
+void TrackCuts::SetTimeCut(G4double time)
+{
+    fTimeCut = time;
+    G4cout << "[Stacking] Global time cut " << (time > 0. ? std::to_string(time/s) + " s" : "off") << G4endl;
+}
@@ -0,0 +1,24 @@
+#include "tracking.hh"
+#include "stepProfiler.hh"
+#include "fluxTally.hh"
+
+MyTrackingAction::MyTrackingAction(StepProfiler* profiler, FluxTally* flux)
+    : fProfiler(profiler),
+      fFlux(flux),
+      fNSteps(0)
+{}
+
+MyTrackingAction::~MyTrackingAction()
+{}
+
+void MyTrackingAction::PreUserTrackingAction(const G4Track*)
+{
+    if (fProfiler->IsEnabled()) fProfiler->StartTrack();
+    if (fFlux->IsEnabled()) fFlux->StartTrack();
+}
+
+void MyTrackingAction::PostUserTrackingAction(const G4Track* track)
+{
+    fNSteps += track->GetCurrentStepNumber();
+    if (fFlux->IsEnabled()) fFlux->EndTrack(track);
+}